@@ -0,0 +1,450 @@
+/*
+ * FogLAMP "Python 3.5" filter, ingest capture and replay.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include <algorithm>
+
+#include <logger.h>
+
+#include "capture.h"
+
+using namespace std;
+
+/**
+ * Constructor: capture is not active by default
+ */
+CaptureWriter::CaptureWriter() : m_file(NULL),
+				 m_size(0),
+				 m_maxSize(0),
+				 m_rotateFiles(0)
+{
+}
+
+/**
+ * Destructor: close current file
+ */
+CaptureWriter::~CaptureWriter()
+{
+	this->close();
+}
+
+/**
+ * Set the capture file
+ *
+ * @param fileName	Capture file name, empty to stop capturing
+ * @param maxSize	Maximum file size in bytes, 0 for no limit
+ * @param rotateFiles	Number of rotated files to keep
+ */
+void CaptureWriter::setFile(const string& fileName,
+			    unsigned long maxSize,
+			    unsigned int rotateFiles)
+{
+	lock_guard<mutex> guard(m_mutex);
+
+	m_maxSize = maxSize;
+	m_rotateFiles = rotateFiles;
+
+	if (fileName.compare(m_fileName) == 0 && m_file)
+	{
+		return;
+	}
+
+	this->close();
+	m_fileName = fileName;
+
+	if (m_fileName.empty())
+	{
+		return;
+	}
+
+	// Each run starts a new file: rotate the previous capture
+	this->rotate();
+	if (m_file)
+	{
+		Logger::getLogger()->info("Capturing ingested readings to '%s'",
+					  m_fileName.c_str());
+	}
+}
+
+/**
+ * Open a new capture file
+ *
+ * @return	True on success
+ */
+bool CaptureWriter::open()
+{
+	m_file = fopen(m_fileName.c_str(), "wb");
+	if (!m_file)
+	{
+		Logger::getLogger()->error("Cannot open capture file '%s': %s",
+					   m_fileName.c_str(),
+					   strerror(errno));
+		return false;
+	}
+
+	fwrite(CAPTURE_MAGIC, CAPTURE_MAGIC_LEN, 1, m_file);
+	m_size = CAPTURE_MAGIC_LEN;
+	return true;
+}
+
+/**
+ * Close the capture file
+ */
+void CaptureWriter::close()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = NULL;
+	}
+}
+
+/**
+ * Rotate capture files and open a new one
+ */
+void CaptureWriter::rotate()
+{
+	this->close();
+
+	if (m_rotateFiles)
+	{
+		for (unsigned int i = m_rotateFiles - 1; i > 0; i--)
+		{
+			rename((m_fileName + "." + to_string(i)).c_str(),
+			       (m_fileName + "." + to_string(i + 1)).c_str());
+		}
+		rename(m_fileName.c_str(), (m_fileName + ".1").c_str());
+	}
+	else
+	{
+		remove(m_fileName.c_str());
+	}
+
+	this->open();
+}
+
+/**
+ * Append a batch of readings to the capture file
+ *
+ * @param readings	The ingested readings
+ */
+void CaptureWriter::write(const vector<Reading *>& readings)
+{
+	lock_guard<mutex> guard(m_mutex);
+
+	if (!m_file)
+	{
+		return;
+	}
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	uint64_t arrivalTime = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+	uint32_t count = readings.size();
+
+	long start = ftell(m_file);
+
+	fwrite(&arrivalTime, sizeof(arrivalTime), 1, m_file);
+	fwrite(&count, sizeof(count), 1, m_file);
+
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		this->writeString((*elem)->getAssetName());
+
+		uint64_t id = (*elem)->getId();
+		fwrite(&id, sizeof(id), 1, m_file);
+
+		struct timeval tm;
+		int64_t times[4];
+		(*elem)->getTimestamp(&tm);
+		times[0] = tm.tv_sec;
+		times[1] = tm.tv_usec;
+		(*elem)->getUserTimestamp(&tm);
+		times[2] = tm.tv_sec;
+		times[3] = tm.tv_usec;
+		fwrite(times, sizeof(times), 1, m_file);
+
+		vector<Datapoint *>& dataPoints = (*elem)->getReadingData();
+		uint32_t dpCount = dataPoints.size();
+		fwrite(&dpCount, sizeof(dpCount), 1, m_file);
+
+		for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
+		{
+			this->writeString((*it)->getName());
+
+			DatapointValue& data = (*it)->getData();
+			DatapointValue::dataTagType dataType = data.getType();
+			uint8_t type;
+			if (dataType == DatapointValue::dataTagType::T_INTEGER)
+			{
+				type = CAPTURE_T_INTEGER;
+				int64_t value = data.toInt();
+				fwrite(&type, sizeof(type), 1, m_file);
+				fwrite(&value, sizeof(value), 1, m_file);
+			}
+			else if (dataType == DatapointValue::dataTagType::T_FLOAT)
+			{
+				type = CAPTURE_T_FLOAT;
+				double value = data.toDouble();
+				fwrite(&type, sizeof(type), 1, m_file);
+				fwrite(&value, sizeof(value), 1, m_file);
+			}
+			else
+			{
+				type = CAPTURE_T_STRING;
+				fwrite(&type, sizeof(type), 1, m_file);
+				this->writeString(dataType == DatapointValue::dataTagType::T_STRING ?
+						  data.toStringValue() :
+						  data.toString());
+			}
+		}
+	}
+
+	if (ferror(m_file))
+	{
+		Logger::getLogger()->error("Error writing capture file '%s', "
+					   "capture has been stopped",
+					   m_fileName.c_str());
+		this->close();
+		return;
+	}
+
+	m_size += ftell(m_file) - start;
+	if (m_maxSize && m_size >= m_maxSize)
+	{
+		this->rotate();
+	}
+}
+
+/**
+ * Write a string as length and bytes
+ *
+ * @param value		The string to write
+ */
+void CaptureWriter::writeString(const string& value)
+{
+	uint32_t len = value.length();
+	fwrite(&len, sizeof(len), 1, m_file);
+	fwrite(value.data(), len, 1, m_file);
+}
+
+/**
+ * Constructor
+ */
+CaptureReader::CaptureReader() : m_file(NULL),
+				 m_size(0)
+{
+}
+
+/**
+ * Destructor: close current file
+ */
+CaptureReader::~CaptureReader()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+	}
+}
+
+/**
+ * Open a capture file and check its header
+ *
+ * @param fileName	The capture file name
+ * @return		True on success
+ */
+bool CaptureReader::open(const string& fileName)
+{
+	m_file = fopen(fileName.c_str(), "rb");
+	if (!m_file)
+	{
+		return false;
+	}
+
+	char magic[CAPTURE_MAGIC_LEN];
+	if (fseek(m_file, 0, SEEK_END) != 0 ||
+	    (m_size = ftell(m_file)) < 0 ||
+	    fseek(m_file, 0, SEEK_SET) != 0 ||
+	    fread(magic, CAPTURE_MAGIC_LEN, 1, m_file) != 1 ||
+	    memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0)
+	{
+		fclose(m_file);
+		m_file = NULL;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Move back to the first batch
+ *
+ * @return		True on success
+ */
+bool CaptureReader::rewind()
+{
+	return m_file && fseek(m_file, CAPTURE_MAGIC_LEN, SEEK_SET) == 0;
+}
+
+/**
+ * Read next batch of readings
+ *
+ * @param arrivalTime	Set to the batch arrival time, in microseconds
+ * @return		New allocated ReadingSet or NULL
+ *			at end of file or errors
+ */
+ReadingSet* CaptureReader::next(uint64_t& arrivalTime)
+{
+	uint32_t count;
+	if (!m_file ||
+	    !this->readValue(arrivalTime) ||
+	    !this->readValue(count))
+	{
+		return NULL;
+	}
+
+	// A corrupt count is detected while reading
+	vector<Reading *>* readings = new vector<Reading *>();
+	readings->reserve(min((long)count, this->remaining()));
+
+	bool ok = true;
+	for (uint32_t i = 0; i < count && ok; i++)
+	{
+		string asset;
+		uint64_t id;
+		int64_t times[4];
+		uint32_t dpCount;
+		if (!this->readString(asset) ||
+		    !this->readValue(id) ||
+		    fread(times, sizeof(times), 1, m_file) != 1 ||
+		    !this->readValue(dpCount))
+		{
+			ok = false;
+			break;
+		}
+
+		vector<Datapoint *> values;
+		for (uint32_t j = 0; j < dpCount; j++)
+		{
+			string name;
+			uint8_t type;
+			if (!this->readString(name) || !this->readValue(type))
+			{
+				ok = false;
+				break;
+			}
+
+			DatapointValue* value = NULL;
+			if (type == CAPTURE_T_INTEGER)
+			{
+				int64_t v;
+				if (this->readValue(v))
+				{
+					value = new DatapointValue((long)v);
+				}
+			}
+			else if (type == CAPTURE_T_FLOAT)
+			{
+				double v;
+				if (this->readValue(v))
+				{
+					value = new DatapointValue(v);
+				}
+			}
+			else if (type == CAPTURE_T_STRING)
+			{
+				string v;
+				if (this->readString(v))
+				{
+					value = new DatapointValue(v);
+				}
+			}
+
+			if (!value)
+			{
+				ok = false;
+				break;
+			}
+			values.push_back(new Datapoint(name, *value));
+			delete value;
+		}
+
+		if (!ok)
+		{
+			for (auto it = values.begin(); it != values.end(); ++it)
+			{
+				delete *it;
+			}
+			break;
+		}
+
+		Reading* reading = new Reading(asset, values);
+		reading->setId(id);
+		struct timeval tm;
+		tm.tv_sec = times[0];
+		tm.tv_usec = times[1];
+		reading->setTimestamp(tm);
+		tm.tv_sec = times[2];
+		tm.tv_usec = times[3];
+		reading->setUserTimestamp(tm);
+		readings->push_back(reading);
+	}
+
+	if (!ok)
+	{
+		// Truncated file
+		for (auto it = readings->begin(); it != readings->end(); ++it)
+		{
+			delete *it;
+		}
+		delete readings;
+		return NULL;
+	}
+
+	ReadingSet* readingSet = new ReadingSet(readings);
+	delete readings;
+
+	return readingSet;
+}
+
+/**
+ * Read a string as length and bytes
+ *
+ * @param value		The string to set
+ * @return		True on success
+ */
+bool CaptureReader::readString(string& value)
+{
+	uint32_t len;
+	if (!this->readValue(len))
+	{
+		return false;
+	}
+	// Truncated or corrupt file
+	if (len > this->remaining())
+	{
+		return false;
+	}
+	value.resize(len);
+	return len == 0 || fread(&value[0], len, 1, m_file) == 1;
+}
+
+/**
+ * Get the bytes left to read
+ *
+ * @return		Bytes from current position to end of file
+ */
+long CaptureReader::remaining() const
+{
+	long pos = ftell(m_file);
+	return pos < 0 || pos > m_size ? 0 : m_size - pos;
+}
@@ -0,0 +1,275 @@
+/*
+ * FogLAMP "Python 3.5" filter, native change detection.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#include "change_detector.h"
+
+using namespace std;
+
+/**
+ * Constructor: change detection is not active by default
+ */
+ChangeDetector::ChangeDetector() :
+				m_active(false),
+				m_absolute(0.0),
+				m_percent(0.0),
+				m_minInterval(0),
+				m_commits(0)
+{
+}
+
+/**
+ * Set the deadband values and reset current state
+ * if any of them changed.
+ *
+ * Change detection is active if at least one value is set.
+ *
+ * @param absolute	Absolute deadband, 0 disables it
+ * @param percent	Percentage deadband, 0 disables it
+ * @param minInterval	Minimum interval in milliseconds
+ *			between readings of the same asset,
+ *			0 disables it
+ */
+void ChangeDetector::setDeadband(double absolute,
+				 double percent,
+				 unsigned long minInterval)
+{
+	absolute = absolute > 0.0 ? absolute : 0.0;
+	percent = percent > 0.0 ? percent : 0.0;
+	if (absolute == m_absolute &&
+	    percent == m_percent &&
+	    minInterval == m_minInterval)
+	{
+		// Unchanged: keep last forwarded values
+		return;
+	}
+
+	m_absolute = absolute;
+	m_percent = percent;
+	m_minInterval = minInterval;
+	m_active = m_absolute > 0.0 || m_percent > 0.0 || m_minInterval > 0;
+
+	this->reset();
+}
+
+/**
+ * Remove all the last forwarded values
+ */
+void ChangeDetector::reset()
+{
+	m_assets.clear();
+}
+
+/**
+ * Select the readings to forward
+ *
+ * Readings are compared with the committed state and with
+ * the readings already selected from the same batch.
+ * The committed state is not changed.
+ *
+ * @param readings	The input readings
+ * @param changed	The output vector with readings to forward
+ * @return		The number of skipped readings
+ */
+unsigned long ChangeDetector::filter(const vector<Reading *>& readings,
+				     vector<Reading *>& changed)
+{
+	changed.reserve(readings.size());
+
+	// State of assets selected in this batch
+	unordered_map<string, AssetState> batch;
+	const AssetState none;
+
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		const string& asset = (*elem)->getAssetName();
+		auto selected = batch.find(asset);
+		auto committed = m_assets.find(asset);
+		const AssetState& state = selected != batch.end() ?
+					  selected->second :
+					  (committed != m_assets.end() ? committed->second : none);
+		if (this->isChanged(state, *elem))
+		{
+			if (selected == batch.end())
+			{
+				selected = batch.insert(make_pair(asset, state)).first;
+			}
+			this->update(selected->second, *elem);
+			changed.push_back(*elem);
+		}
+	}
+
+	return readings.size() - changed.size();
+}
+
+/**
+ * Save the last forwarded state from readings selected
+ * by filter() and passed onwards, removing the least
+ * recently forwarded assets above CHANGE_MAX_ASSETS
+ *
+ * @param readings	The forwarded readings, in input order
+ */
+void ChangeDetector::commit(const vector<Reading *>& readings)
+{
+	m_commits++;
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		AssetState& state = m_assets[(*elem)->getAssetName()];
+		this->update(state, *elem);
+		state.m_lastCommit = m_commits;
+	}
+
+	if (m_assets.size() > CHANGE_MAX_ASSETS)
+	{
+		this->evict();
+	}
+}
+
+/**
+ * Remove the least recently forwarded assets,
+ * down to 90% of CHANGE_MAX_ASSETS
+ */
+void ChangeDetector::evict()
+{
+	vector<pair<unsigned long, const string *>> ages;
+	ages.reserve(m_assets.size());
+	for (auto it = m_assets.begin(); it != m_assets.end(); ++it)
+	{
+		ages.push_back(make_pair(it->second.m_lastCommit, &it->first));
+	}
+
+	size_t remove = m_assets.size() - CHANGE_MAX_ASSETS * 9 / 10;
+	nth_element(ages.begin(), ages.begin() + remove, ages.end());
+
+	// Copy the names: keys are removed with their state
+	vector<string> names;
+	names.reserve(remove);
+	for (size_t i = 0; i < remove; i++)
+	{
+		names.push_back(*ages[i].second);
+	}
+	for (auto it = names.begin(); it != names.end(); ++it)
+	{
+		m_assets.erase(*it);
+	}
+}
+
+/**
+ * Check whether a reading has to be forwarded
+ *
+ * @param state		The last forwarded state of reading asset
+ * @param reading	The reading to check
+ * @return		True if reading has to be forwarded
+ */
+bool ChangeDetector::isChanged(const AssetState& state, Reading* reading) const
+{
+	if (!state.m_hasTimestamp)
+	{
+		// First reading of this asset
+		return true;
+	}
+
+	if (m_minInterval)
+	{
+		struct timeval ts;
+		reading->getUserTimestamp(&ts);
+		long elapsed = (ts.tv_sec - state.m_timestamp.tv_sec) * 1000L +
+			       (ts.tv_usec - state.m_timestamp.tv_usec) / 1000L;
+		if (elapsed >= 0 && (unsigned long)elapsed < m_minInterval)
+		{
+			return false;
+		}
+	}
+
+	if (m_absolute == 0.0 && m_percent == 0.0)
+	{
+		// Only minimum interval is set
+		return true;
+	}
+
+	vector<Datapoint *>& dataPoints = reading->getReadingData();
+	for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
+	{
+		auto last = state.m_values.find((*it)->getName());
+		if (last == state.m_values.end())
+		{
+			// New datapoint
+			return true;
+		}
+
+		DatapointValue& data = (*it)->getData();
+		DatapointValue::dataTagType dataType = data.getType();
+		if (dataType == DatapointValue::dataTagType::T_INTEGER ||
+		    dataType == DatapointValue::dataTagType::T_FLOAT)
+		{
+			if (!last->second.m_numeric)
+			{
+				return true;
+			}
+			double value = dataType == DatapointValue::dataTagType::T_INTEGER ?
+				       (double)data.toInt() :
+				       data.toDouble();
+			// Within all the deadbands set
+			double delta = fabs(value - last->second.m_number);
+			bool inBand = (m_absolute == 0.0 || delta <= m_absolute) &&
+				      (m_percent == 0.0 ||
+				       delta <= fabs(last->second.m_number) * m_percent / 100.0);
+			if (!inBand)
+			{
+				return true;
+			}
+		}
+		else if (last->second.m_numeric ||
+			 last->second.m_text.compare(data.toString()) != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Save reading values and timestamp as last forwarded ones
+ *
+ * @param state		The last forwarded state of reading asset
+ * @param reading	The forwarded reading
+ */
+void ChangeDetector::update(AssetState& state, Reading* reading)
+{
+	reading->getUserTimestamp(&state.m_timestamp);
+	state.m_hasTimestamp = true;
+
+	vector<Datapoint *>& dataPoints = reading->getReadingData();
+	for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
+	{
+		LastValue& last = state.m_values[(*it)->getName()];
+		DatapointValue& data = (*it)->getData();
+		DatapointValue::dataTagType dataType = data.getType();
+		if (dataType == DatapointValue::dataTagType::T_INTEGER)
+		{
+			last.m_numeric = true;
+			last.m_number = (double)data.toInt();
+		}
+		else if (dataType == DatapointValue::dataTagType::T_FLOAT)
+		{
+			last.m_numeric = true;
+			last.m_number = data.toDouble();
+		}
+		else
+		{
+			last.m_numeric = false;
+			last.m_text = data.toString();
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/*
+ * FogLAMP "Python 3.5" filter, pool of Python input containers.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include "container_pool.h"
+
+using namespace std;
+
+/**
+ * Constructor: empty pool
+ */
+ContainerPool::ContainerPool()
+{
+}
+
+/**
+ * Get an empty dict, reusing a recycled one if available
+ *
+ * @return	New reference to an empty dict
+ */
+PyObject* ContainerPool::getDict()
+{
+	PyObject* dict;
+	if (!m_free.empty())
+	{
+		dict = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		dict = PyDict_New();
+		if (!dict)
+		{
+			return NULL;
+		}
+	}
+
+	// Pool reference, checked by recycle()
+	Py_INCREF(dict);
+	m_inUse.push_back(dict);
+
+	return dict;
+}
+
+/**
+ * Clear a dict and set its items again,
+ * when keys of a previous use are left
+ *
+ * @param dict		The dict
+ * @param items		The keys and values to set
+ */
+void ContainerPool::refill(PyObject* dict,
+			   const vector<pair<PyObject *, PyObject *>>& items)
+{
+	PyDict_Clear(dict);
+	for (auto it = items.begin(); it != items.end(); ++it)
+	{
+		PyDict_SetItem(dict, it->first, it->second);
+	}
+}
+
+/**
+ * Recycle the dicts of current batch which are no longer referenced
+ * by the script, releasing the others
+ *
+ * Values of recycled dicts are set to None: nested dicts
+ * are released and can be recycled by their pool.
+ */
+void ContainerPool::recycle()
+{
+	for (auto it = m_inUse.begin(); it != m_inUse.end(); ++it)
+	{
+		if (Py_REFCNT(*it) == 1 && m_free.size() < CONTAINER_POOL_SIZE)
+		{
+			// Replacing values of existing keys does not resize the dict
+			PyObject *key, *value;
+			Py_ssize_t pos = 0;
+			while (PyDict_Next(*it, &pos, &key, &value))
+			{
+				if (value != Py_None)
+				{
+					PyDict_SetItem(*it, key, Py_None);
+				}
+			}
+			m_free.push_back(*it);
+		}
+		else
+		{
+			Py_DECREF(*it);
+		}
+	}
+	m_inUse.clear();
+}
+
+/**
+ * Release all the dicts
+ */
+void ContainerPool::clear()
+{
+	this->recycle();
+	for (auto it = m_free.begin(); it != m_free.end(); ++it)
+	{
+		Py_DECREF(*it);
+	}
+	m_free.clear();
+}
@@ -0,0 +1,205 @@
+/*
+ * FogLAMP "Python 3.5" filter, memory budget of Python conversions.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <chrono>
+
+#include "conversion_budget.h"
+
+using namespace std;
+
+atomic<unsigned long> ConversionBudget::m_inFlight(0);
+mutex ConversionBudget::m_waitMutex;
+condition_variable ConversionBudget::m_waitCond;
+
+/**
+ * Constructor: no budget by default
+ */
+ConversionBudget::ConversionBudget() :
+				m_budget(0),
+				m_policy(BUDGET_SPLIT),
+				m_splitBatches(0),
+				m_pieces(0),
+				m_passedBatches(0),
+				m_waits(0)
+{
+}
+
+/**
+ * Set the memory budget and the policy for batches over it
+ *
+ * @param bytes		The budget in bytes, 0 disables it
+ * @param policy	The policy name: "split" or "passthrough"
+ */
+void ConversionBudget::setBudget(unsigned long bytes, const string& policy)
+{
+	m_budget = bytes;
+	m_policy = policy.compare("passthrough") == 0 ?
+		   BUDGET_PASSTHROUGH :
+		   BUDGET_SPLIT;
+}
+
+/**
+ * Estimate Python memory of converted readings
+ *
+ * @param readings	The readings
+ * @param start		Index of first reading
+ * @param count		Number of readings
+ * @return		Estimated bytes
+ */
+unsigned long ConversionBudget::estimate(const vector<Reading *>& readings,
+					 size_t start,
+					 size_t count)
+{
+	unsigned long bytes = 0;
+	for (size_t i = start; i < start + count; i++)
+	{
+		bytes += CONVERSION_READING_BYTES +
+			 readings[i]->getDatapointCount() * CONVERSION_DATAPOINT_BYTES;
+	}
+	return bytes;
+}
+
+/**
+ * Check whether a batch over the budget has to be passed onwards
+ * without filtering
+ *
+ * @param readings	The readings to convert
+ * @return		True if batch is over the budget
+ *			and policy is passthrough
+ */
+bool ConversionBudget::passThrough(const vector<Reading *>& readings)
+{
+	unsigned long budget = m_budget;
+	if (!budget ||
+	    m_policy != BUDGET_PASSTHROUGH ||
+	    m_inFlight + estimate(readings, 0, readings.size()) <= budget)
+	{
+		return false;
+	}
+	m_passedBatches++;
+	return true;
+}
+
+/**
+ * Reserve budget for the readings which fit the available one
+ *
+ * Budget is reserved atomically, in a single step, against
+ * concurrent conversions of all filter instances. A single reading
+ * bigger than the whole budget is reserved when nothing is in flight.
+ *
+ * If no reading fits, the split policy waits for released budget,
+ * converting one reading anyway after BUDGET_MAX_WAIT, while the
+ * passthrough policy returns 0.
+ *
+ * @param readings	The readings to convert
+ * @param start		Index of first reading to convert
+ * @param count		Maximum number of readings
+ * @param bytes		Set to reserved bytes of returned readings
+ * @return		Number of readings to convert, 0 to pass
+ *			the readings onwards unfiltered
+ */
+size_t ConversionBudget::reserve(const vector<Reading *>& readings,
+				 size_t start,
+				 size_t count,
+				 unsigned long& bytes)
+{
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(BUDGET_MAX_WAIT);
+	bool waited = false;
+
+	while (true)
+	{
+		unsigned long budget = m_budget;
+		if (!budget)
+		{
+			// Budget disabled meanwhile
+			bytes = 0;
+			return count;
+		}
+		unsigned long inFlight = m_inFlight;
+		unsigned long available = budget > inFlight ? budget - inFlight : 0;
+
+		bytes = 0;
+		size_t n;
+		for (n = 0; n < count; n++)
+		{
+			unsigned long cost = estimate(readings, start + n, 1);
+			if (bytes + cost > available)
+			{
+				break;
+			}
+			bytes += cost;
+		}
+		if (n == 0 && count && (inFlight == 0 || chrono::steady_clock::now() >= deadline))
+		{
+			// Reading over the whole budget or waited too long
+			bytes = estimate(readings, start, 1);
+			n = 1;
+		}
+
+		if (n > 0)
+		{
+			if (m_inFlight.compare_exchange_weak(inFlight, inFlight + bytes))
+			{
+				return n;
+			}
+			// Budget changed meanwhile
+			continue;
+		}
+
+		// Budget used by other conversions
+		if (m_policy == BUDGET_PASSTHROUGH)
+		{
+			m_passedBatches++;
+			return 0;
+		}
+		if (!waited)
+		{
+			waited = true;
+			m_waits++;
+		}
+		unique_lock<mutex> lock(m_waitMutex);
+		m_waitCond.wait_for(lock, chrono::milliseconds(BUDGET_WAIT_TIME));
+	}
+}
+
+/**
+ * Count a batch converted in pieces because of the budget
+ *
+ * @param pieces	Number of pieces
+ */
+void ConversionBudget::countSplit(unsigned long pieces)
+{
+	m_splitBatches++;
+	m_pieces += pieces;
+}
+
+/**
+ * Release estimated bytes of converted readings
+ *
+ * @param bytes		Estimated bytes
+ */
+void ConversionBudget::release(unsigned long bytes)
+{
+	m_inFlight -= bytes;
+	m_waitCond.notify_all();
+}
+
+/**
+ * Get budget action counters
+ *
+ * @return	Counters as text
+ */
+string ConversionBudget::getStats() const
+{
+	return "split batches " + to_string(m_splitBatches) +
+	       ", pieces " + to_string(m_pieces) +
+	       ", passed through batches " + to_string(m_passedBatches) +
+	       ", waits " + to_string(m_waits);
+}
@@ -0,0 +1,381 @@
+/*
+ * FogLAMP "Python 3.5" filter, datapoint value converters.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <vector>
+
+#include "converters.h"
+
+using namespace std;
+
+typedef DatapointValue::dataTagType DataTag;
+
+/**
+ * Converter templates: one specialisation per DatapointValue type
+ *
+ * ToPython<T>::convert	returns a new reference or NULL
+ * FromPython<T>::check	returns true if the Python object has type T
+ * FromPython<T>::convert	returns a new allocated value or NULL
+ */
+template <DataTag T> struct ToPython;
+template <DataTag T> struct FromPython;
+
+template <> struct ToPython<DatapointValue::dataTagType::T_INTEGER>
+{
+	static PyObject* convert(DatapointValue& value)
+	{
+		return PyLong_FromLong(value.toInt());
+	}
+};
+
+template <> struct FromPython<DatapointValue::dataTagType::T_INTEGER>
+{
+	static bool check(PyObject* value)
+	{
+		return PyLong_Check(value);
+	}
+	static DatapointValue* convert(PyObject* value)
+	{
+		int overflow;
+		long v = PyLong_AsLongAndOverflow(value, &overflow);
+		if (overflow > 0)
+		{
+			// Unsigned values above LONG_MAX keep their bits,
+			// values above ULONG_MAX raise OverflowError
+			v = (long)PyLong_AsUnsignedLong(value);
+		}
+		else if (overflow < 0)
+		{
+			// Values below LONG_MIN cannot be represented either
+			PyErr_SetString(PyExc_OverflowError,
+					"int too small to convert to a datapoint value");
+		}
+		return PyErr_Occurred() ? NULL : new DatapointValue(v);
+	}
+};
+
+template <> struct ToPython<DatapointValue::dataTagType::T_FLOAT>
+{
+	static PyObject* convert(DatapointValue& value)
+	{
+		return PyFloat_FromDouble(value.toDouble());
+	}
+};
+
+template <> struct FromPython<DatapointValue::dataTagType::T_FLOAT>
+{
+	static bool check(PyObject* value)
+	{
+		return PyFloat_Check(value);
+	}
+	static DatapointValue* convert(PyObject* value)
+	{
+		return new DatapointValue(PyFloat_AS_DOUBLE(value));
+	}
+};
+
+template <> struct ToPython<DatapointValue::dataTagType::T_STRING>
+{
+	static PyObject* convert(DatapointValue& value)
+	{
+		// Raw string value, without JSON quotes
+		string text = value.toStringValue();
+		return PyBytes_FromStringAndSize(text.data(), text.length());
+	}
+};
+
+template <> struct FromPython<DatapointValue::dataTagType::T_STRING>
+{
+	static bool check(PyObject* value)
+	{
+		return PyBytes_Check(value) || PyUnicode_Check(value);
+	}
+	static DatapointValue* convert(PyObject* value)
+	{
+		string text;
+		return nameFromPython(value, text) ? new DatapointValue(text) : NULL;
+	}
+};
+
+template <> struct ToPython<DatapointValue::dataTagType::T_FLOAT_ARRAY>
+{
+	static PyObject* convert(DatapointValue& value)
+	{
+		vector<double>* values = value.getDpArr();
+		PyObject* list = PyList_New(values ? values->size() : 0);
+		for (size_t i = 0; list && values && i < values->size(); i++)
+		{
+			// Reference is stolen
+			PyList_SET_ITEM(list, i, PyFloat_FromDouble((*values)[i]));
+		}
+		return list;
+	}
+};
+
+template <> struct FromPython<DatapointValue::dataTagType::T_FLOAT_ARRAY>
+{
+	// Non empty list of floats
+	static bool check(PyObject* value)
+	{
+		if (!PyList_Check(value) || PyList_GET_SIZE(value) == 0)
+		{
+			return false;
+		}
+		for (Py_ssize_t i = 0; i < PyList_GET_SIZE(value); i++)
+		{
+			if (!PyFloat_Check(PyList_GET_ITEM(value, i)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	static DatapointValue* convert(PyObject* value)
+	{
+		vector<double> values;
+		values.reserve(PyList_GET_SIZE(value));
+		for (Py_ssize_t i = 0; i < PyList_GET_SIZE(value); i++)
+		{
+			values.push_back(PyFloat_AS_DOUBLE(PyList_GET_ITEM(value, i)));
+		}
+		return new DatapointValue(values);
+	}
+};
+
+/**
+ * Delete datapoints created while converting a nested value
+ *
+ * @param values	The datapoints to delete
+ */
+static void deleteDatapoints(vector<Datapoint *>* values)
+{
+	for (auto it = values->begin(); it != values->end(); ++it)
+	{
+		delete *it;
+	}
+	delete values;
+}
+
+template <> struct ToPython<DatapointValue::dataTagType::T_DP_DICT>
+{
+	static PyObject* convert(DatapointValue& value)
+	{
+		vector<Datapoint *>* values = value.getDpVec();
+		PyObject* dict = PyDict_New();
+		for (size_t i = 0; dict && values && i < values->size(); i++)
+		{
+			PyObject* key = nameToPython((*values)[i]->getName());
+			PyObject* item = datapointToPython((*values)[i]->getData());
+			if (!key || !item || PyDict_SetItem(dict, key, item) != 0)
+			{
+				Py_CLEAR(dict);
+			}
+			Py_CLEAR(key);
+			Py_CLEAR(item);
+		}
+		return dict;
+	}
+};
+
+template <> struct FromPython<DatapointValue::dataTagType::T_DP_DICT>
+{
+	static bool check(PyObject* value)
+	{
+		return PyDict_Check(value);
+	}
+	static DatapointValue* convert(PyObject* value)
+	{
+		vector<Datapoint *>* values = new vector<Datapoint *>();
+		values->reserve(PyDict_Size(value));
+
+		PyObject *key, *item;
+		Py_ssize_t pos = 0;
+		while (PyDict_Next(value, &pos, &key, &item))
+		{
+			string name;
+			DatapointValue* dataPoint = nameFromPython(key, name) ?
+						    datapointFromPython(item) :
+						    NULL;
+			if (!dataPoint)
+			{
+				deleteDatapoints(values);
+				return NULL;
+			}
+			values->push_back(new Datapoint(name, *dataPoint));
+			delete dataPoint;
+		}
+		// Vector is owned by the new value
+		return new DatapointValue(values, true);
+	}
+};
+
+template <> struct ToPython<DatapointValue::dataTagType::T_DP_LIST>
+{
+	static PyObject* convert(DatapointValue& value)
+	{
+		vector<Datapoint *>* values = value.getDpVec();
+		PyObject* list = PyList_New(values ? values->size() : 0);
+		for (size_t i = 0; list && values && i < values->size(); i++)
+		{
+			PyObject* item = datapointToPython((*values)[i]->getData());
+			if (!item)
+			{
+				Py_CLEAR(list);
+				break;
+			}
+			// Reference is stolen
+			PyList_SET_ITEM(list, i, item);
+		}
+		return list;
+	}
+};
+
+template <> struct FromPython<DatapointValue::dataTagType::T_DP_LIST>
+{
+	static bool check(PyObject* value)
+	{
+		return PyList_Check(value);
+	}
+	static DatapointValue* convert(PyObject* value)
+	{
+		vector<Datapoint *>* values = new vector<Datapoint *>();
+		values->reserve(PyList_GET_SIZE(value));
+
+		for (Py_ssize_t i = 0; i < PyList_GET_SIZE(value); i++)
+		{
+			DatapointValue* dataPoint = datapointFromPython(PyList_GET_ITEM(value, i));
+			if (!dataPoint)
+			{
+				deleteDatapoints(values);
+				return NULL;
+			}
+			// List items are named by their index
+			values->push_back(new Datapoint(to_string(i), *dataPoint));
+			delete dataPoint;
+		}
+		// Vector is owned by the new value
+		return new DatapointValue(values, false);
+	}
+};
+
+typedef PyObject* (*ToPythonFunc)(DatapointValue&);
+
+// DatapointValue to Python dispatch table, indexed by type
+static const ToPythonFunc toPythonTable[] = {
+	&ToPython<DatapointValue::dataTagType::T_STRING>::convert,
+	&ToPython<DatapointValue::dataTagType::T_INTEGER>::convert,
+	&ToPython<DatapointValue::dataTagType::T_FLOAT>::convert,
+	&ToPython<DatapointValue::dataTagType::T_FLOAT_ARRAY>::convert,
+	&ToPython<DatapointValue::dataTagType::T_DP_DICT>::convert,
+	&ToPython<DatapointValue::dataTagType::T_DP_LIST>::convert
+};
+
+static_assert(DatapointValue::dataTagType::T_STRING == 0 &&
+	      DatapointValue::dataTagType::T_INTEGER == 1 &&
+	      DatapointValue::dataTagType::T_FLOAT == 2 &&
+	      DatapointValue::dataTagType::T_FLOAT_ARRAY == 3 &&
+	      DatapointValue::dataTagType::T_DP_DICT == 4 &&
+	      DatapointValue::dataTagType::T_DP_LIST == 5,
+	      "toPythonTable order must match DatapointValue types");
+
+typedef struct
+{
+	bool		(*check)(PyObject*);
+	DatapointValue*	(*convert)(PyObject*);
+} FromPythonEntry;
+
+/**
+ * Python to DatapointValue dispatch table, in check order:
+ * a list of floats is a float array, other lists are datapoint lists
+ */
+#define FROM_PYTHON(T) { &FromPython<DatapointValue::dataTagType::T>::check, \
+			 &FromPython<DatapointValue::dataTagType::T>::convert }
+static const FromPythonEntry fromPythonTable[] = {
+	FROM_PYTHON(T_INTEGER),
+	FROM_PYTHON(T_FLOAT),
+	FROM_PYTHON(T_STRING),
+	FROM_PYTHON(T_FLOAT_ARRAY),
+	FROM_PYTHON(T_DP_LIST),
+	FROM_PYTHON(T_DP_DICT)
+};
+
+/**
+ * Convert a datapoint value into a Python object
+ *
+ * @param value		The datapoint value
+ * @return		New reference or NULL for unknown types
+ */
+PyObject* datapointToPython(DatapointValue& value)
+{
+	size_t type = value.getType();
+	if (type >= sizeof(toPythonTable) / sizeof(toPythonTable[0]))
+	{
+		return NULL;
+	}
+	return toPythonTable[type](value);
+}
+
+/**
+ * Convert a Python object into a datapoint value
+ *
+ * @param value		The Python object
+ * @return		New allocated value or NULL for unsupported
+ *			Python types
+ */
+DatapointValue* datapointFromPython(PyObject* value)
+{
+	for (size_t i = 0; i < sizeof(fromPythonTable) / sizeof(fromPythonTable[0]); i++)
+	{
+		if (fromPythonTable[i].check(value))
+		{
+			return fromPythonTable[i].convert(value);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Create the Python object of an asset or datapoint name
+ *
+ * @param name		The name
+ * @return		New reference (bytes)
+ */
+PyObject* nameToPython(const string& name)
+{
+	return PyBytes_FromStringAndSize(name.data(), name.length());
+}
+
+/**
+ * Get an asset or datapoint name, or a string value,
+ * from a Python bytes or str object
+ *
+ * @param name		The Python object
+ * @param value		Set to the string
+ * @return		False if object is not bytes or str
+ */
+bool nameFromPython(PyObject* name, string& value)
+{
+	if (PyBytes_Check(name))
+	{
+		value.assign(PyBytes_AS_STRING(name), PyBytes_GET_SIZE(name));
+		return true;
+	}
+	if (PyUnicode_Check(name))
+	{
+		Py_ssize_t size;
+		const char* text = PyUnicode_AsUTF8AndSize(name, &size);
+		if (text)
+		{
+			value.assign(text, size);
+			return true;
+		}
+		PyErr_Clear();
+	}
+	return false;
+}
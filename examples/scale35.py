@@ -12,20 +12,10 @@ __version__ = "${VERSION}"
 
 import sys
 import json
-import logging
-from logging.handlers import SysLogHandler
-import os
 
-# Log to syslog
-handler = SysLogHandler(address='/dev/log')
-formatter = logging.Formatter(fmt='FogLAMP[%(process)d] %(levelname)s: %(name)s: %(message)s')
-handler.setFormatter(formatter)
-# When embedded Python is in use sys.argv is not defined,
-logger = logging.getLogger(os.path.basename(__file__))
-
-# Set mininum log severity
-logger.setLevel(logging.DEBUG)
-logger.addHandler(handler)
+# Native module of the filter plugin:
+# messages are formatted only if FogLAMP log level enables them
+import foglamp_filter
 
 """
 Filter configuration set by set_filter_config(config)
@@ -65,7 +55,7 @@ Returns:
 True
 """
 def set_filter_config(configuration):
-    logger.debug("Config = " + str(configuration)) 
+    foglamp_filter.log(foglamp_filter.DEBUG, "Config = %s", configuration)
     global filter_config
     filter_config = json.loads(configuration['config'])
 
@@ -109,7 +99,7 @@ def scale35(readings):
 
     # Process input data
     for elem in readings:
-            logger.debug("IN=" + str(elem))
+            foglamp_filter.log(foglamp_filter.DEBUG, "IN=%s", elem)
             reading = elem['reading']
 
             # Apply some changes: multiply datapoint values by scale and add offset
@@ -117,5 +107,8 @@ def scale35(readings):
                 newVal = reading[key] * scale + offset
                 reading[key] = newVal
 
-            logger.debug("OUT=" + str(elem))
+            foglamp_filter.log(foglamp_filter.DEBUG, "OUT=%s", elem)
+
+    # Count processed readings
+    foglamp_filter.counter("readings", len(readings))
     return readings
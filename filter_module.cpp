@@ -0,0 +1,324 @@
+/*
+ * FogLAMP "Python 3.5" filter, embedded foglamp_filter module.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <syslog.h>
+#include <string>
+
+#include "python35.h"
+
+using namespace std;
+
+/**
+ * The foglamp_filter module can be imported by filter scripts:
+ *
+ * - log(level, fmt, *args)
+ *   Log a message via FogLAMP logger. The message is formatted
+ *   as fmt % args only if level is enabled.
+ *   Levels are foglamp_filter.DEBUG, INFO, WARNING and ERROR
+ *
+ * - counter(name, value=1)
+ *   Add value to a filter counter
+ *
+ * - gauge(name, value)
+ *   Set a filter gauge value
+ *
+ * - emit(readings)
+ *   Pass a list of readings to the next filter now, without
+ *   waiting for the filter method to return
+ *
+ * - reading
+ *   The reading record type
+ */
+
+// Filter calling script code in current thread
+static thread_local Python35Filter* currentFilter = NULL;
+
+/**
+ * Set current filter
+ *
+ * @param filter	The filter calling script code
+ */
+FilterScope::FilterScope(Python35Filter* filter) : m_previous(currentFilter)
+{
+	currentFilter = filter;
+}
+
+/**
+ * Restore previous filter
+ */
+FilterScope::~FilterScope()
+{
+	currentFilter = m_previous;
+}
+
+/**
+ * Add a value to a counter
+ *
+ * @param name		The counter name
+ * @param value		The value to add
+ */
+void ScriptMetrics::counter(const string& name, long long value)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_counters[name] += value;
+}
+
+/**
+ * Set a gauge value
+ *
+ * @param name		The gauge name
+ * @param value		The new value
+ */
+void ScriptMetrics::gauge(const string& name, double value)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_gauges[name] = value;
+}
+
+/**
+ * Remove all counters and gauges
+ */
+void ScriptMetrics::reset()
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_counters.clear();
+	m_gauges.clear();
+}
+
+/**
+ * Get a copy of current counters
+ *
+ * @param counters	The map to fill
+ */
+void ScriptMetrics::getCounters(map<string, long long>& counters)
+{
+	lock_guard<mutex> guard(m_mutex);
+	counters = m_counters;
+}
+
+/**
+ * Get a copy of current gauges
+ *
+ * @param gauges	The map to fill
+ */
+void ScriptMetrics::getGauges(map<string, double>& gauges)
+{
+	lock_guard<mutex> guard(m_mutex);
+	gauges = m_gauges;
+}
+
+/**
+ * foglamp_filter.log(level, fmt, *args)
+ */
+static PyObject* filterLog(PyObject* self, PyObject* args)
+{
+	Py_ssize_t nArgs = PyTuple_Size(args);
+	if (nArgs < 2)
+	{
+		PyErr_SetString(PyExc_TypeError,
+				"log() requires level and format arguments");
+		return NULL;
+	}
+
+	long level = PyLong_AsLong(PyTuple_GET_ITEM(args, 0));
+	if (level == -1 && PyErr_Occurred())
+	{
+		return NULL;
+	}
+	if (level < LOG_EMERG || level > LOG_DEBUG)
+	{
+		PyErr_SetString(PyExc_ValueError, "log() invalid level");
+		return NULL;
+	}
+
+	// FogLAMP Logger sets its minimum level as syslog mask:
+	// check it before formatting the message
+	if (!(setlogmask(0) & LOG_MASK(level)))
+	{
+		Py_RETURN_NONE;
+	}
+
+	PyObject* format = PyTuple_GET_ITEM(args, 1);
+	PyObject* message;
+	if (nArgs > 2)
+	{
+		PyObject* formatArgs = PyTuple_GetSlice(args, 2, nArgs);
+		message = PyUnicode_Format(format, formatArgs);
+		Py_CLEAR(formatArgs);
+	}
+	else
+	{
+		message = PyObject_Str(format);
+	}
+
+	const char* text = message ? PyUnicode_AsUTF8(message) : NULL;
+	if (!text)
+	{
+		Py_CLEAR(message);
+		return NULL;
+	}
+
+	const char* script = currentFilter ?
+			     currentFilter->m_pythonScript.c_str() :
+			     FILTER_MODULE_NAME;
+	Logger* logger = Logger::getLogger();
+	switch (level)
+	{
+		case LOG_DEBUG:
+			logger->debug("%s: %s", script, text);
+			break;
+		case LOG_INFO:
+		case LOG_NOTICE:
+			logger->info("%s: %s", script, text);
+			break;
+		case LOG_WARNING:
+			logger->warn("%s: %s", script, text);
+			break;
+		case LOG_ERR:
+			logger->error("%s: %s", script, text);
+			break;
+		default:
+			logger->fatal("%s: %s", script, text);
+			break;
+	}
+
+	Py_CLEAR(message);
+	Py_RETURN_NONE;
+}
+
+/**
+ * foglamp_filter.counter(name, value=1)
+ */
+static PyObject* filterCounter(PyObject* self, PyObject* args)
+{
+	const char* name;
+	long long value = 1;
+	if (!PyArg_ParseTuple(args, "s|L:counter", &name, &value))
+	{
+		return NULL;
+	}
+
+	if (currentFilter)
+	{
+		currentFilter->getMetrics().counter(name, value);
+	}
+	Py_RETURN_NONE;
+}
+
+/**
+ * foglamp_filter.gauge(name, value)
+ */
+static PyObject* filterGauge(PyObject* self, PyObject* args)
+{
+	const char* name;
+	double value;
+	if (!PyArg_ParseTuple(args, "sd:gauge", &name, &value))
+	{
+		return NULL;
+	}
+
+	if (currentFilter)
+	{
+		currentFilter->getMetrics().gauge(name, value);
+	}
+	Py_RETURN_NONE;
+}
+
+/**
+ * foglamp_filter.emit(readings)
+ */
+static PyObject* filterEmit(PyObject* self, PyObject* args)
+{
+	PyObject* readings;
+	if (!PyArg_ParseTuple(args, "O:emit", &readings))
+	{
+		return NULL;
+	}
+
+	if (!currentFilter)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "emit() called outside of a filter");
+		return NULL;
+	}
+
+	if (!currentFilter->emit(readings))
+	{
+		return NULL;
+	}
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef filterModuleMethods[] = {
+	{"log", filterLog, METH_VARARGS,
+	 "log(level, fmt, *args): log fmt % args if level is enabled"},
+	{"counter", filterCounter, METH_VARARGS,
+	 "counter(name, value=1): add value to a filter counter"},
+	{"gauge", filterGauge, METH_VARARGS,
+	 "gauge(name, value): set a filter gauge"},
+	{"emit", filterEmit, METH_VARARGS,
+	 "emit(readings): pass a list of readings to the next filter"},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef filterModuleDef = {
+	PyModuleDef_HEAD_INIT,
+	FILTER_MODULE_NAME,
+	"FogLAMP Python 3.5 filter native module",
+	-1,
+	filterModuleMethods,
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+/**
+ * Create foglamp_filter module, if not done yet,
+ * and add it to the imported modules
+ *
+ * This method must be called holding the GIL
+ *
+ * @return	True on success, false on errors
+ */
+bool initFilterModule()
+{
+	// Borrowed reference
+	PyObject* modules = PyImport_GetModuleDict();
+	if (PyDict_GetItemString(modules, FILTER_MODULE_NAME))
+	{
+		return true;
+	}
+
+	PyObject* module = PyModule_Create(&filterModuleDef);
+	if (!module)
+	{
+		PyErr_Clear();
+		Logger::getLogger()->error("Cannot create Python 3.5 module '%s'",
+					   FILTER_MODULE_NAME);
+		return false;
+	}
+
+	PyModule_AddIntConstant(module, "DEBUG", LOG_DEBUG);
+	PyModule_AddIntConstant(module, "INFO", LOG_INFO);
+	PyModule_AddIntConstant(module, "WARNING", LOG_WARNING);
+	PyModule_AddIntConstant(module, "ERROR", LOG_ERR);
+
+	if (initReadingRecordType())
+	{
+		// Reference is stolen
+		Py_INCREF(readingRecordType);
+		PyModule_AddObject(module, "reading", (PyObject *)readingRecordType);
+	}
+
+	bool ret = PyDict_SetItemString(modules, FILTER_MODULE_NAME, module) == 0;
+	Py_CLEAR(module);
+
+	return ret;
+}
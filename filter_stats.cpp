@@ -0,0 +1,358 @@
+/*
+ * FogLAMP "Python 3.5" filter, performance counters and stats endpoint.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <logger.h>
+
+#include "filter_stats.h"
+
+// Poll timeout of stats server, in milliseconds
+#define STATS_POLL_TIMEOUT 500
+
+using namespace std;
+
+/**
+ * Constructor: all counters are zero
+ */
+FilterStats::FilterStats() : m_batches(0),
+			     m_readingsIn(0),
+			     m_readingsOut(0),
+			     m_drops(0),
+			     m_errors(0),
+			     m_gilWait(0),
+			     m_bytes(0),
+			     m_schemaRejected(0),
+			     m_schemaRepaired(0),
+			     m_shed(0),
+			     m_overloadTransitions(0),
+			     m_overloaded(false)
+{
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+	{
+		m_latency[i] = 0;
+	}
+}
+
+/**
+ * Add a batch latency to the histogram
+ *
+ * @param usec		Latency in microseconds
+ */
+void FilterStats::addLatency(uint64_t usec)
+{
+	int bucket = 0;
+	while (bucket < STATS_LATENCY_BUCKETS - 1 && (1ULL << bucket) <= usec)
+	{
+		bucket++;
+	}
+	add(m_latency[bucket], 1);
+}
+
+/**
+ * Estimate a latency quantile from the histogram
+ *
+ * @param q		The quantile, 0 to 1
+ * @return		Upper bound of the quantile bucket, in seconds
+ */
+double FilterStats::quantile(double q) const
+{
+	uint64_t counts[STATS_LATENCY_BUCKETS];
+	uint64_t total = 0;
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+	{
+		counts[i] = m_latency[i].load(memory_order_relaxed);
+		total += counts[i];
+	}
+	if (!total)
+	{
+		return 0.0;
+	}
+
+	uint64_t rank = (uint64_t)(q * total);
+	uint64_t sum = 0;
+	int i;
+	for (i = 0; i < STATS_LATENCY_BUCKETS - 1; i++)
+	{
+		sum += counts[i];
+		if (sum > rank)
+		{
+			break;
+		}
+	}
+	return (double)(1ULL << i) / 1000000.0;
+}
+
+/**
+ * Escape a Prometheus label value: backslash,
+ * double quote and new line are escaped
+ *
+ * @param value		The label value
+ * @return		The escaped value
+ */
+string FilterStats::escapeLabel(const string& value)
+{
+	string escaped;
+	escaped.reserve(value.length());
+	for (auto c = value.begin(); c != value.end(); ++c)
+	{
+		switch (*c)
+		{
+			case '\\':
+				escaped += "\\\\";
+				break;
+			case '"':
+				escaped += "\\\"";
+				break;
+			case '\n':
+				escaped += "\\n";
+				break;
+			default:
+				escaped += *c;
+				break;
+		}
+	}
+	return escaped;
+}
+
+/**
+ * Format counters in Prometheus text format
+ *
+ * @param filterName	The filter name, used as label
+ * @return		The counters text
+ */
+string FilterStats::format(const string& filterName) const
+{
+	string label = "{filter=\"" + escapeLabel(filterName) + "\"";
+	string text;
+
+	const struct
+	{
+		const char*			name;
+		const char*			help;
+		const std::atomic<uint64_t>*	value;
+	} counters[] = {
+		{ "batches_total", "Ingested batches", &m_batches },
+		{ "readings_in_total", "Ingested readings", &m_readingsIn },
+		{ "readings_out_total", "Readings passed onwards", &m_readingsOut },
+		{ "drops_total", "Readings removed before the script", &m_drops },
+		{ "errors_total", "Batches passed onwards after script errors", &m_errors },
+		{ "gil_wait_microseconds_total", "Time spent waiting for the GIL", &m_gilWait },
+		{ "converted_bytes_total", "Estimated bytes of readings converted to Python", &m_bytes },
+		{ "schema_rejected_total", "Readings rejected by the output schema", &m_schemaRejected },
+		{ "schema_repaired_total", "Values converted by the output schema", &m_schemaRepaired },
+		{ "overload_shed_total", "Readings not filtered by the script under overload", &m_shed },
+		{ "overload_transitions_total", "Changes between normal and overload state", &m_overloadTransitions }
+	};
+
+	for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+	{
+		string name = string("foglamp_python35_") + counters[i].name;
+		text += "# HELP " + name + " " + counters[i].help + "\n";
+		text += "# TYPE " + name + " counter\n";
+		text += name + label + "} " +
+			to_string(counters[i].value->load(memory_order_relaxed)) + "\n";
+	}
+
+	text += "# HELP foglamp_python35_overloaded Filter is in overload state\n";
+	text += "# TYPE foglamp_python35_overloaded gauge\n";
+	text += "foglamp_python35_overloaded" + label + "} " +
+		(m_overloaded.load(memory_order_relaxed) ? "1" : "0") + "\n";
+
+	text += "# HELP foglamp_python35_latency_seconds Batch processing latency\n";
+	text += "# TYPE foglamp_python35_latency_seconds summary\n";
+	const double quantiles[] = { 0.5, 0.9, 0.99 };
+	for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++)
+	{
+		char line[64];
+		snprintf(line, sizeof(line), ",quantile=\"%g\"} %g\n",
+			 quantiles[i],
+			 this->quantile(quantiles[i]));
+		text += "foglamp_python35_latency_seconds" + label + line;
+	}
+
+	return text;
+}
+
+/**
+ * Constructor: server is not running
+ */
+StatsServer::StatsServer() : m_thread(NULL),
+			     m_running(false),
+			     m_socket(-1)
+{
+}
+
+/**
+ * Destructor: stop the server thread
+ */
+StatsServer::~StatsServer()
+{
+	this->stop();
+}
+
+/**
+ * Start serving on a Unix domain socket, stopping current server
+ *
+ * @param socketPath	The socket path, empty for no server
+ * @param render	Function returning the document to serve
+ */
+void StatsServer::start(const string& socketPath,
+			function<string()> render)
+{
+	if (m_thread && socketPath.compare(m_socketPath) == 0)
+	{
+		return;
+	}
+
+	this->stop();
+
+	m_socketPath = socketPath;
+	if (m_socketPath.empty())
+	{
+		return;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (m_socketPath.length() >= sizeof(addr.sun_path))
+	{
+		Logger::getLogger()->error("Stats socket path '%s' is too long",
+					   m_socketPath.c_str());
+		return;
+	}
+	strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+	if (!this->removeSocket())
+	{
+		return;
+	}
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_socket < 0 ||
+	    bind(m_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(m_socket, 4) < 0)
+	{
+		Logger::getLogger()->error("Cannot listen on stats socket '%s': %s",
+					   m_socketPath.c_str(),
+					   strerror(errno));
+		if (m_socket >= 0)
+		{
+			close(m_socket);
+			m_socket = -1;
+		}
+		return;
+	}
+
+	m_render = render;
+	m_running = true;
+	m_thread = new thread(&StatsServer::run, this);
+}
+
+/**
+ * Stop the server thread and remove the socket
+ */
+void StatsServer::stop()
+{
+	if (!m_thread)
+	{
+		return;
+	}
+
+	m_running = false;
+	m_thread->join();
+	delete m_thread;
+	m_thread = NULL;
+
+	close(m_socket);
+	m_socket = -1;
+	this->removeSocket();
+}
+
+/**
+ * Remove a stale socket left at the socket path:
+ * any other file is left in place
+ *
+ * @return	True if the path is free to bind
+ */
+bool StatsServer::removeSocket() const
+{
+	struct stat st;
+	if (lstat(m_socketPath.c_str(), &st) < 0)
+	{
+		if (errno == ENOENT)
+		{
+			return true;
+		}
+		Logger::getLogger()->error("Cannot check stats socket '%s': %s",
+					   m_socketPath.c_str(),
+					   strerror(errno));
+		return false;
+	}
+	if (!S_ISSOCK(st.st_mode))
+	{
+		Logger::getLogger()->error("Stats socket path '%s' exists and is not a socket",
+					   m_socketPath.c_str());
+		return false;
+	}
+	if (unlink(m_socketPath.c_str()) < 0)
+	{
+		Logger::getLogger()->error("Cannot remove stats socket '%s': %s",
+					   m_socketPath.c_str(),
+					   strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Server thread loop
+ */
+void StatsServer::run()
+{
+	while (m_running)
+	{
+		struct pollfd fds;
+		fds.fd = m_socket;
+		fds.events = POLLIN;
+		if (poll(&fds, 1, STATS_POLL_TIMEOUT) <= 0)
+		{
+			continue;
+		}
+
+		int client = accept(m_socket, NULL, NULL);
+		if (client < 0)
+		{
+			continue;
+		}
+
+		string text = m_render();
+		const char* data = text.data();
+		size_t left = text.length();
+		while (left > 0)
+		{
+			ssize_t n = send(client, data, left, MSG_NOSIGNAL);
+			if (n <= 0)
+			{
+				break;
+			}
+			data += n;
+			left -= n;
+		}
+		close(client);
+	}
+}
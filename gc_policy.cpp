@@ -0,0 +1,253 @@
+/*
+ * FogLAMP "Python 3.5" filter, garbage collection policy.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdio.h>
+
+#include <logger.h>
+
+#include "gc_policy.h"
+
+using namespace std;
+
+unsigned long GcPolicy::m_disabledCalls = 0;
+bool GcPolicy::m_wasEnabled = false;
+
+/**
+ * Constructor: default Python collection
+ */
+GcPolicy::GcPolicy() : m_policy(GC_DEFAULT),
+		       m_batches(0),
+		       m_interval(0),
+		       m_idleTime(0),
+		       m_batchCount(0),
+		       m_pending(false),
+		       m_collections(0),
+		       m_collected(0),
+		       m_totalPause(0.0),
+		       m_maxPause(0.0),
+		       m_deferred(0)
+{
+	m_lastBatch = m_lastCollection = chrono::steady_clock::now();
+}
+
+/**
+ * Set the collection policy
+ *
+ * @param policy	Policy name: default, batch or idle
+ * @param batches	Batch policy: collect every number of batches, 0 disables it
+ * @param interval	Batch policy: collect every interval milliseconds, 0 disables it
+ * @param idleTime	Idle policy: collect after idle time milliseconds
+ */
+void GcPolicy::setPolicy(const string& policy,
+			 unsigned long batches,
+			 unsigned long interval,
+			 unsigned long idleTime)
+{
+	if (policy.compare("batch") == 0)
+	{
+		m_policy = GC_BATCH;
+	}
+	else if (policy.compare("idle") == 0)
+	{
+		m_policy = GC_IDLE;
+	}
+	else
+	{
+		m_policy = GC_DEFAULT;
+	}
+	m_batches = batches;
+	m_interval = interval;
+	m_idleTime = idleTime;
+	m_batchCount = 0;
+}
+
+/**
+ * Call a method of Python gc module without arguments
+ *
+ * @param method	The method name
+ * @return		New reference to method result or NULL
+ */
+PyObject* GcPolicy::callGc(const char* method)
+{
+	// gc is already in sys.modules: this is a dict lookup
+	PyObject* gcModule = PyImport_ImportModule("gc");
+	if (!gcModule)
+	{
+		return NULL;
+	}
+	PyObject* ret = PyObject_CallMethod(gcModule, (char *)method, NULL);
+	Py_CLEAR(gcModule);
+	return ret;
+}
+
+/**
+ * Disable automatic collection before calling the script
+ *
+ * Scripts of other filter instances might run while this one
+ * released the GIL: calls are counted and collection is disabled
+ * by the first one.
+ *
+ * @return	True if the call has been counted,
+ *		to be passed to afterCall
+ */
+bool GcPolicy::beforeCall()
+{
+	if (m_policy == GC_DEFAULT)
+	{
+		return false;
+	}
+
+	if (m_disabledCalls++ == 0)
+	{
+		PyObject* enabled = callGc("isenabled");
+		m_wasEnabled = enabled && PyObject_IsTrue(enabled) == 1;
+		Py_CLEAR(enabled);
+
+		if (m_wasEnabled)
+		{
+			PyObject* ret = callGc("disable");
+			Py_CLEAR(ret);
+		}
+		PyErr_Clear();
+	}
+
+	return true;
+}
+
+/**
+ * Restore automatic collection after calling the script,
+ * if this is the last running call, and collect if batch
+ * policy budget is reached
+ *
+ * @param counted	Value returned by beforeCall
+ */
+void GcPolicy::afterCall(bool counted)
+{
+	if (m_policy != GC_DEFAULT)
+	{
+		m_lastBatch = chrono::steady_clock::now();
+		m_pending = true;
+		m_batchCount++;
+
+		if (m_policy == GC_BATCH &&
+		    ((m_batches && m_batchCount >= m_batches) ||
+		     (m_interval && m_lastBatch - m_lastCollection >= chrono::milliseconds(m_interval))))
+		{
+			this->collect();
+		}
+	}
+
+	if (counted && --m_disabledCalls == 0 && m_wasEnabled)
+	{
+		this->collectDeferred();
+
+		PyObject* ret = callGc("enable");
+		Py_CLEAR(ret);
+		PyErr_Clear();
+	}
+}
+
+/**
+ * Run the young generation collection deferred while automatic
+ * collection was disabled, if its threshold has been reached:
+ * otherwise it would run at any later allocation, possibly in
+ * the script of another filter.
+ */
+void GcPolicy::collectDeferred()
+{
+	PyObject* count = callGc("get_count");
+	PyObject* threshold = callGc("get_threshold");
+	if (count && threshold &&
+	    PyTuple_Check(count) && PyTuple_Check(threshold) &&
+	    PyTuple_GET_SIZE(count) > 0 && PyTuple_GET_SIZE(threshold) > 0)
+	{
+		long young = PyLong_AsLong(PyTuple_GET_ITEM(count, 0));
+		long limit = PyLong_AsLong(PyTuple_GET_ITEM(threshold, 0));
+		if (limit > 0 && young > limit)
+		{
+			PyObject* gcModule = PyImport_ImportModule("gc");
+			PyObject* collected = gcModule ?
+					      PyObject_CallMethod(gcModule,
+								  (char *)"collect",
+								  (char *)"i",
+								  0) :
+					      NULL;
+			if (collected)
+			{
+				m_collected += PyLong_AsUnsignedLong(collected);
+				m_deferred++;
+			}
+			Py_CLEAR(collected);
+			Py_CLEAR(gcModule);
+		}
+	}
+	Py_CLEAR(count);
+	Py_CLEAR(threshold);
+	PyErr_Clear();
+}
+
+/**
+ * Idle policy: collect if no batch arrived for idle time
+ * and no collection has been done since last batch
+ */
+void GcPolicy::collectIfIdle()
+{
+	if (m_policy == GC_IDLE &&
+	    m_pending &&
+	    chrono::steady_clock::now() - m_lastBatch >= chrono::milliseconds(m_idleTime))
+	{
+		this->collect();
+	}
+}
+
+/**
+ * Run a full collection and update statistics
+ */
+void GcPolicy::collect()
+{
+	auto tStart = chrono::steady_clock::now();
+	PyObject* collected = callGc("collect");
+	auto tEnd = chrono::steady_clock::now();
+
+	if (collected)
+	{
+		m_collected += PyLong_AsUnsignedLong(collected);
+	}
+	Py_CLEAR(collected);
+	PyErr_Clear();
+
+	double pause = chrono::duration<double, milli>(tEnd - tStart).count();
+	m_totalPause += pause;
+	if (pause > m_maxPause)
+	{
+		m_maxPause = pause;
+	}
+	m_collections++;
+	m_batchCount = 0;
+	m_pending = false;
+	m_lastCollection = tEnd;
+}
+
+/**
+ * Return collection statistics as a string
+ */
+string GcPolicy::getStats() const
+{
+	char buf[200];
+	snprintf(buf, sizeof(buf),
+		 "collections %lu, deferred young collections %lu, "
+		 "collected objects %lu, total pause %.3f ms, max pause %.3f ms",
+		 m_collections,
+		 m_deferred,
+		 m_collected,
+		 m_totalPause,
+		 m_maxPause);
+	return string(buf);
+}
@@ -0,0 +1,107 @@
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+/*
+ * FogLAMP "Python 3.5" filter, ingest capture and replay.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include <reading_set.h>
+
+// Capture file header
+#define CAPTURE_MAGIC "FLPYCAP1"
+#define CAPTURE_MAGIC_LEN 8
+
+// Datapoint value types in capture file
+#define CAPTURE_T_INTEGER 'I'
+#define CAPTURE_T_FLOAT 'F'
+#define CAPTURE_T_STRING 'S'
+
+/**
+ * CaptureWriter class appends the ingested readings to a binary file,
+ * with the arrival time of each batch.
+ *
+ * Each run starts a new file, rotating the previous one.
+ * When the file is bigger than the maximum size it is rotated:
+ * file is renamed as file.1, file.1 as file.2 and so on, up to
+ * the configured number of rotated files.
+ *
+ * File format, native byte order:
+ *   header:	"FLPYCAP1"
+ *   batch:	uint64 arrival time (microseconds), uint32 readings count
+ *   reading:	string asset, uint64 id,
+ *		int64 ts sec, int64 ts usec, int64 user_ts sec, int64 user_ts usec,
+ *		uint32 datapoints count
+ *   datapoint:	string name, uint8 type, value
+ *   value:	int64 (I), double (F) or string (S)
+ *   string:	uint32 length, bytes
+ *
+ * Values other than integer and float are saved as strings.
+ */
+class CaptureWriter
+{
+	public:
+		CaptureWriter();
+		~CaptureWriter();
+
+		void	setFile(const std::string& fileName,
+				unsigned long maxSize,
+				unsigned int rotateFiles);
+		bool	isActive() const { return m_file != NULL; };
+		void	write(const std::vector<Reading *>& readings);
+
+	private:
+		bool	open();
+		void	close();
+		void	rotate();
+		void	writeString(const std::string& value);
+
+	private:
+		std::mutex	m_mutex;
+		FILE*		m_file;
+		std::string	m_fileName;
+		unsigned long	m_size;
+		unsigned long	m_maxSize;
+		unsigned int	m_rotateFiles;
+};
+
+/**
+ * CaptureReader class reads back the batches
+ * saved by CaptureWriter
+ */
+class CaptureReader
+{
+	public:
+		CaptureReader();
+		~CaptureReader();
+
+		bool	open(const std::string& fileName);
+		bool	rewind();
+		ReadingSet*
+			next(uint64_t& arrivalTime);
+
+	private:
+		bool	readString(std::string& value);
+		long	remaining() const;
+		template <typename T> bool
+			readValue(T& value)
+			{
+				return fread(&value, sizeof(T), 1, m_file) == 1;
+			};
+
+	private:
+		FILE*		m_file;
+		// File size, bounds lengths read from the file
+		long		m_size;
+};
+#endif
@@ -0,0 +1,99 @@
+#ifndef _CHANGE_DETECTOR_H
+#define _CHANGE_DETECTOR_H
+/*
+ * FogLAMP "Python 3.5" filter, native change detection.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sys/time.h>
+
+#include <reading.h>
+
+// Maximum number of assets with a last forwarded state:
+// least recently forwarded assets are removed above it
+#define CHANGE_MAX_ASSETS 10000
+
+/**
+ * ChangeDetector class keeps the last forwarded value
+ * of each (asset, datapoint) pair and removes readings
+ * which did not change enough, before they are converted
+ * into Python objects.
+ *
+ * A reading is skipped when:
+ * - it arrives within 'minInterval' milliseconds (reading
+ *   user timestamp) of the last forwarded reading of the same asset
+ * - or all of its datapoint values are within the deadband
+ *   of the last forwarded values.
+ *
+ * A numeric value is within the deadband if the absolute change is
+ * not greater than the absolute deadband and not greater than the
+ * percentage deadband of the last forwarded value: when both are set,
+ * a change over either of them is forwarded.
+ * Non numeric values are within the deadband only when unchanged.
+ *
+ * The last forwarded state is saved by commit(), once the selected
+ * readings have been filtered: readings which did not reach the
+ * script are compared again with the previous state. Up to
+ * CHANGE_MAX_ASSETS assets are kept.
+ */
+class ChangeDetector
+{
+	public:
+		ChangeDetector();
+
+		void	setDeadband(double absolute,
+				    double percent,
+				    unsigned long minInterval);
+		bool	isActive() const { return m_active; };
+		void	reset();
+		unsigned long
+			filter(const std::vector<Reading *>& readings,
+			       std::vector<Reading *>& changed);
+		void	commit(const std::vector<Reading *>& readings);
+
+	private:
+		// Last forwarded value of a datapoint
+		class LastValue
+		{
+			public:
+				bool		m_numeric;
+				double		m_number;
+				std::string	m_text;
+		};
+		// Last forwarded state of an asset
+		class AssetState
+		{
+			public:
+				AssetState() : m_hasTimestamp(false), m_lastCommit(0) {};
+				bool		m_hasTimestamp;
+				struct timeval	m_timestamp;
+				// Commit sequence number of last update
+				unsigned long	m_lastCommit;
+				std::unordered_map<std::string, LastValue>
+						m_values;
+		};
+
+		bool	isChanged(const AssetState& state, Reading* reading) const;
+		void	update(AssetState& state, Reading* reading);
+		void	evict();
+
+	private:
+		bool		m_active;
+		double		m_absolute;
+		double		m_percent;
+		// Minimum interval in milliseconds
+		unsigned long	m_minInterval;
+		// State of active assets, by asset name
+		std::unordered_map<std::string, AssetState>
+				m_assets;
+		unsigned long	m_commits;
+};
+#endif
@@ -0,0 +1,57 @@
+#ifndef _CONTAINER_POOL_H
+#define _CONTAINER_POOL_H
+/*
+ * FogLAMP "Python 3.5" filter, pool of Python input containers.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <vector>
+
+#include <Python.h>
+
+// Maximum number of free dicts kept by a pool
+#define CONTAINER_POOL_SIZE 10000
+
+/**
+ * ContainerPool class recycles the dicts passed to the script.
+ *
+ * The pool keeps a reference to each dict handed out for a batch:
+ * after the script call, dicts the script did not retain (only the
+ * pool reference is left) are reused for next batch.
+ *
+ * Recycled dicts keep their keys, with None values: setting the same
+ * keys again overwrites values in place, without allocating a new
+ * key table. Callers must check the dict size after setting items
+ * and refill it with refill() if keys of a previous use are left.
+ *
+ * When dicts nest, the pool of outer dicts must be recycled first.
+ *
+ * All methods must be called holding the GIL
+ */
+class ContainerPool
+{
+	public:
+		ContainerPool();
+
+		PyObject*
+			getDict();
+		static void
+			refill(PyObject* dict,
+			       const std::vector<std::pair<PyObject *, PyObject *>>& items);
+		void	recycle();
+		void	clear();
+
+	private:
+		// Dicts handed out for current batch
+		std::vector<PyObject *>
+				m_inUse;
+		// Cleared dicts ready for reuse
+		std::vector<PyObject *>
+				m_free;
+};
+#endif
@@ -0,0 +1,92 @@
+#ifndef _CONVERSION_BUDGET_H
+#define _CONVERSION_BUDGET_H
+/*
+ * FogLAMP "Python 3.5" filter, memory budget of Python conversions.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include <reading.h>
+
+// Estimated Python memory of a converted reading, without datapoints
+#define CONVERSION_READING_BYTES 640
+// Estimated Python memory of a converted datapoint
+#define CONVERSION_DATAPOINT_BYTES 128
+// Wait for released budget, in milliseconds
+#define BUDGET_WAIT_TIME 10
+// Maximum wait before converting a reading anyway, in milliseconds
+#define BUDGET_MAX_WAIT 5000
+
+/**
+ * ConversionBudget class limits the estimated memory of readings
+ * converted into Python objects and not yet released.
+ *
+ * The footprint is estimated from reading and datapoint counts
+ * and accounted process-wide, across all filter instances.
+ * A batch over the budget is either converted in pieces which
+ * fit the budget (split policy) or passed onwards unfiltered
+ * (passthrough policy).
+ *
+ * When the budget is used up by other conversions, the split policy
+ * waits for released budget while the passthrough policy passes the
+ * rest of the batch onwards unfiltered.
+ */
+class ConversionBudget
+{
+	public:
+		enum Policy { BUDGET_SPLIT, BUDGET_PASSTHROUGH };
+
+		ConversionBudget();
+
+		void	setBudget(unsigned long bytes, const std::string& policy);
+		bool	isActive() const { return m_budget != 0; };
+		Policy	getPolicy() const { return m_policy; };
+		static unsigned long
+			estimate(const std::vector<Reading *>& readings,
+				 size_t start,
+				 size_t count);
+		bool	passThrough(const std::vector<Reading *>& readings);
+		size_t	reserve(const std::vector<Reading *>& readings,
+				size_t start,
+				size_t count,
+				unsigned long& bytes);
+		void	countSplit(unsigned long pieces);
+		void	release(unsigned long bytes);
+		std::string
+			getStats() const;
+
+	private:
+		// Set by reconfiguration while batches are converted
+		std::atomic<unsigned long>
+				m_budget;
+		std::atomic<Policy>
+				m_policy;
+		// Counters of budget actions
+		std::atomic<unsigned long>
+				m_splitBatches;
+		std::atomic<unsigned long>
+				m_pieces;
+		std::atomic<unsigned long>
+				m_passedBatches;
+		std::atomic<unsigned long>
+				m_waits;
+		// Estimated bytes in flight in all filter instances
+		static std::atomic<unsigned long>
+				m_inFlight;
+		// Wake up of conversions waiting for budget
+		static std::mutex
+				m_waitMutex;
+		static std::condition_variable
+				m_waitCond;
+};
+#endif
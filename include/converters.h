@@ -0,0 +1,39 @@
+#ifndef _CONVERTERS_H
+#define _CONVERTERS_H
+/*
+ * FogLAMP "Python 3.5" filter, datapoint value converters.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+
+#include <reading.h>
+
+#include <Python.h>
+
+/**
+ * Conversions between DatapointValue and Python objects.
+ *
+ * Each DatapointValue type has a specialisation of the
+ * ToPython and FromPython converter templates; the dispatch
+ * tables are built from the specialisations at compile time.
+ *
+ *   T_INTEGER		int
+ *   T_FLOAT		float
+ *   T_STRING		bytes (str is also accepted from Python)
+ *   T_FLOAT_ARRAY	list of floats
+ *   T_DP_DICT		dict of datapoint name (bytes) to value
+ *   T_DP_LIST		list of values
+ *
+ * All functions must be called holding the GIL
+ */
+PyObject*	datapointToPython(DatapointValue& value);
+DatapointValue*	datapointFromPython(PyObject* value);
+PyObject*	nameToPython(const std::string& name);
+bool		nameFromPython(PyObject* name, std::string& value);
+#endif
@@ -0,0 +1,60 @@
+#ifndef _FILTER_MODULE_H
+#define _FILTER_MODULE_H
+/*
+ * FogLAMP "Python 3.5" filter, embedded foglamp_filter module.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <map>
+#include <mutex>
+
+// Name of the module scripts can import
+#define FILTER_MODULE_NAME "foglamp_filter"
+
+class Python35Filter;
+
+/**
+ * ScriptMetrics class holds the counters and gauges
+ * set by a filter script via foglamp_filter module
+ */
+class ScriptMetrics
+{
+	public:
+		void	counter(const std::string& name, long long value);
+		void	gauge(const std::string& name, double value);
+		void	reset();
+		void	getCounters(std::map<std::string, long long>& counters);
+		void	getGauges(std::map<std::string, double>& gauges);
+
+	private:
+		std::mutex	m_mutex;
+		std::map<std::string, long long>
+				m_counters;
+		std::map<std::string, double>
+				m_gauges;
+};
+
+/**
+ * FilterScope class sets the filter which is calling
+ * Python script code in current thread, so that
+ * foglamp_filter module calls are bound to it.
+ * Previous filter is restored when the object is deleted.
+ */
+class FilterScope
+{
+	public:
+		FilterScope(Python35Filter* filter);
+		~FilterScope();
+
+	private:
+		Python35Filter*	m_previous;
+};
+
+bool initFilterModule();
+#endif
@@ -0,0 +1,113 @@
+#ifndef _FILTER_STATS_H
+#define _FILTER_STATS_H
+/*
+ * FogLAMP "Python 3.5" filter, performance counters and stats endpoint.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+// Latency histogram buckets: bucket i counts latencies below 2^i microseconds
+#define STATS_LATENCY_BUCKETS 32
+
+/**
+ * FilterStats class holds the performance counters of a filter.
+ *
+ * Counters are atomics updated with relaxed ordering: updates
+ * and reads from other threads do not take any lock.
+ */
+class FilterStats
+{
+	public:
+		FilterStats();
+
+		void	addBatch(uint64_t readingsIn) { add(m_batches, 1); add(m_readingsIn, readingsIn); };
+		void	addReadingsOut(uint64_t readings) { add(m_readingsOut, readings); };
+		void	addDrops(uint64_t readings) { add(m_drops, readings); };
+		void	addError() { add(m_errors, 1); };
+		void	addGilWait(uint64_t usec) { add(m_gilWait, usec); };
+		void	addBytes(uint64_t bytes) { add(m_bytes, bytes); };
+		void	addShed(uint64_t readings) { add(m_shed, readings); };
+		void	addSchemaResults(uint64_t rejected, uint64_t repaired)
+			{
+				add(m_schemaRejected, rejected);
+				add(m_schemaRepaired, repaired);
+			};
+		void	addOverloadTransition(bool overloaded)
+			{
+				add(m_overloadTransitions, 1);
+				m_overloaded.store(overloaded, std::memory_order_relaxed);
+			};
+		void	addLatency(uint64_t usec);
+		std::string
+			format(const std::string& filterName) const;
+		static std::string
+			escapeLabel(const std::string& value);
+
+	private:
+		static void
+			add(std::atomic<uint64_t>& counter, uint64_t value)
+			{
+				counter.fetch_add(value, std::memory_order_relaxed);
+			};
+		double	quantile(double q) const;
+
+	private:
+		std::atomic<uint64_t>	m_batches;
+		std::atomic<uint64_t>	m_readingsIn;
+		std::atomic<uint64_t>	m_readingsOut;
+		std::atomic<uint64_t>	m_drops;
+		std::atomic<uint64_t>	m_errors;
+		// GIL wait time, in microseconds
+		std::atomic<uint64_t>	m_gilWait;
+		// Estimated bytes of readings converted into Python objects
+		std::atomic<uint64_t>	m_bytes;
+		// Output schema rejected readings and repaired values
+		std::atomic<uint64_t>	m_schemaRejected;
+		std::atomic<uint64_t>	m_schemaRepaired;
+		// Readings not filtered by the script under overload
+		std::atomic<uint64_t>	m_shed;
+		std::atomic<uint64_t>	m_overloadTransitions;
+		std::atomic<bool>	m_overloaded;
+		std::atomic<uint64_t>	m_latency[STATS_LATENCY_BUCKETS];
+};
+
+/**
+ * StatsServer class serves a text document on a Unix domain
+ * socket: each connection receives the document and is closed.
+ */
+class StatsServer
+{
+	public:
+		StatsServer();
+		~StatsServer();
+
+		void	start(const std::string& socketPath,
+			      std::function<std::string()> render);
+		void	stop();
+		const std::string&
+			getSocketPath() const { return m_socketPath; };
+
+	private:
+		void	run();
+		bool	removeSocket() const;
+
+	private:
+		std::thread*	m_thread;
+		std::atomic<bool>
+				m_running;
+		int		m_socket;
+		std::string	m_socketPath;
+		std::function<std::string()>
+				m_render;
+};
+#endif
@@ -0,0 +1,87 @@
+#ifndef _GC_POLICY_H
+#define _GC_POLICY_H
+/*
+ * FogLAMP "Python 3.5" filter, garbage collection policy.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <chrono>
+
+#include <Python.h>
+
+/**
+ * GcPolicy class controls when the Python cyclic garbage
+ * collector runs around the calls to the filter script:
+ *
+ * - default: automatic collection is not changed
+ * - batch: automatic collection is disabled during script calls,
+ *   a collection runs after a number of batches or an interval
+ * - idle: automatic collection is disabled during script calls,
+ *   a collection runs when no batch arrived for the idle time
+ *
+ * Automatic collection is disabled by the first script call
+ * of any filter instance and enabled again, if it was enabled,
+ * by the last one to return. The young generation collection
+ * deferred while disabled is run before enabling it.
+ *
+ * All methods must be called holding the GIL
+ */
+class GcPolicy
+{
+	public:
+		enum Policy { GC_DEFAULT, GC_BATCH, GC_IDLE };
+
+		GcPolicy();
+
+		void	setPolicy(const std::string& policy,
+				  unsigned long batches,
+				  unsigned long interval,
+				  unsigned long idleTime);
+		Policy	getPolicy() const { return m_policy; };
+		unsigned long
+			getIdleTime() const { return m_idleTime; };
+		bool	beforeCall();
+		void	afterCall(bool counted);
+		void	collectIfIdle();
+		std::string
+			getStats() const;
+
+	private:
+		static PyObject*
+			callGc(const char* method);
+		void	collect();
+		void	collectDeferred();
+
+	private:
+		Policy		m_policy;
+		// Collect every m_batches batches
+		unsigned long	m_batches;
+		// Collect every m_interval milliseconds
+		unsigned long	m_interval;
+		// Collect after m_idleTime milliseconds without batches
+		unsigned long	m_idleTime;
+		unsigned long	m_batchCount;
+		bool		m_pending;
+		std::chrono::steady_clock::time_point
+				m_lastBatch;
+		std::chrono::steady_clock::time_point
+				m_lastCollection;
+		// Statistics
+		unsigned long	m_collections;
+		unsigned long	m_collected;
+		double		m_totalPause;
+		double		m_maxPause;
+		unsigned long	m_deferred;
+		// Script calls of all filter instances with collection disabled
+		static unsigned long
+				m_disabledCalls;
+		// Automatic collection was enabled before first call
+		static bool	m_wasEnabled;
+};
+#endif
@@ -0,0 +1,61 @@
+#ifndef _MEMORY_ACCOUNTING_H
+#define _MEMORY_ACCOUNTING_H
+/*
+ * FogLAMP "Python 3.5" filter, Python memory accounting.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+
+#include <Python.h>
+
+// Number of batches in an accounting window
+#define MEMORY_WINDOW_BATCHES 100
+// Number of growing windows before an alert
+#define MEMORY_DRIFT_WINDOWS 5
+
+/**
+ * MemoryAccounting class measures the Python allocated blocks
+ * retained by each batch and, every window of batches if
+ * enabled, the number of objects tracked by the garbage collector,
+ * which walks the whole heap.
+ *
+ * An alert is logged when the measured values grow across
+ * consecutive windows.
+ *
+ * All methods must be called holding the GIL
+ */
+class MemoryAccounting
+{
+	public:
+		MemoryAccounting();
+
+		void	setEnabled(bool enabled, bool countObjects);
+		void	beforeBatch();
+		void	afterBatch(const std::string& filterName);
+
+	private:
+		Py_ssize_t
+			allocatedBlocks();
+		Py_ssize_t
+			liveObjects();
+
+	private:
+		bool		m_enabled;
+		bool		m_countObjects;
+		unsigned long	m_batches;
+		Py_ssize_t	m_blocksBefore;
+		// Values at the end of previous window
+		Py_ssize_t	m_windowBlocks;
+		Py_ssize_t	m_windowObjects;
+		// Values at the start of the drift
+		Py_ssize_t	m_driftBlocks;
+		Py_ssize_t	m_driftObjects;
+		unsigned int	m_growingWindows;
+};
+#endif
@@ -0,0 +1,66 @@
+#ifndef _MEMORY_RECLAIM_H
+#define _MEMORY_RECLAIM_H
+/*
+ * FogLAMP "Python 3.5" filter, post-burst memory reclamation.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <atomic>
+#include <chrono>
+
+// Idle time in milliseconds before reclaiming after a big batch,
+// when no idle time is set
+#define RECLAIM_DEFAULT_DELAY 1000
+
+/**
+ * MemoryReclaimer class returns memory to the system after bursts:
+ * Python free lists are cleared by a full collection and the
+ * C heap is trimmed.
+ *
+ * Reclamation is requested by batches with at least the threshold
+ * number of readings, or by any batch when an idle time is set, and
+ * it runs from a timer once no batch is running and none arrived
+ * for the idle time, out of the ingest path.
+ */
+class MemoryReclaimer
+{
+	public:
+		MemoryReclaimer();
+
+		void	setPolicy(unsigned long batchSize, unsigned long idleTime);
+		bool	isActive() const { return m_batchSize || m_idleTime; };
+		unsigned long
+			getCheckInterval() const;
+		void	batchStarted() { m_running++; };
+		void	batchDone(size_t readings);
+		bool	isDue();
+		long	reclaim();
+		std::string
+			getStats() const;
+
+	private:
+		static long
+			residentSize();
+
+	private:
+		// Minimum readings of a batch requesting reclamation
+		unsigned long	m_batchSize;
+		// Idle time in milliseconds
+		unsigned long	m_idleTime;
+		std::atomic<bool>
+				m_pending;
+		// Batches being processed
+		std::atomic<unsigned int>
+				m_running;
+		std::atomic<std::chrono::steady_clock::rep>
+				m_lastBatch;
+		unsigned long	m_reclaims;
+		long		m_reclaimed;
+};
+#endif
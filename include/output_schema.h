@@ -0,0 +1,85 @@
+#ifndef _OUTPUT_SCHEMA_H
+#define _OUTPUT_SCHEMA_H
+/*
+ * FogLAMP "Python 3.5" filter, script output schema.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+
+#include <reading.h>
+
+#include <Python.h>
+
+/**
+ * OutputSchema class holds the output schema declared
+ * by the script in its 'output_schema' global variable:
+ *
+ *   output_schema = {
+ *       "asset_name": {"datapoint_name": "int", "other": "float", "text": "str"}
+ *   }
+ *
+ * Datapoints of readings with a declared asset are fetched
+ * by name and converted by declared type without type probing.
+ * Datapoints are looked up by bytes keys, as passed to the script,
+ * then by str keys, as scripts may add them.
+ * Values of a compatible type are repaired (i.e. int to float),
+ * readings with values which cannot be converted are rejected.
+ *
+ * All methods must be called holding the GIL
+ */
+class OutputSchema
+{
+	public:
+		enum FieldType { FIELD_INTEGER, FIELD_FLOAT, FIELD_STRING };
+
+		class Field
+		{
+			public:
+				std::string	m_name;
+				FieldType	m_type;
+				// Cached dict key objects: bytes and str
+				PyObject*	m_key;
+				PyObject*	m_strKey;
+		};
+
+		OutputSchema();
+
+		bool	compile(PyObject* schema,
+				std::function<PyObject*(const std::string&)> makeKey);
+		void	clear();
+		bool	isActive() const { return !m_assets.empty(); };
+		const std::vector<Field>*
+			getFields(const std::string& asset) const;
+		bool	decode(const std::string& asset,
+			       const std::vector<Field>& fields,
+			       PyObject* reading,
+			       Reading** newReading,
+			       unsigned long& repaired);
+		void	addResults(unsigned long rejected, unsigned long repaired)
+			{
+				m_rejected += rejected;
+				m_repaired += repaired;
+			};
+		std::string
+			getStats() const;
+
+	private:
+		std::unordered_map<std::string, std::vector<Field>>
+				m_assets;
+		// Totals of rejected readings and repaired values
+		std::atomic<unsigned long>
+				m_rejected;
+		std::atomic<unsigned long>
+				m_repaired;
+};
+#endif
@@ -0,0 +1,99 @@
+#ifndef _OVERLOAD_CONTROL_H
+#define _OVERLOAD_CONTROL_H
+/*
+ * FogLAMP "Python 3.5" filter, adaptive overload control.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <reading.h>
+
+// Weight of last sample in moving averages
+#define OVERLOAD_EWMA_WEIGHT 0.2
+// Recover when load is below this ratio of the limits
+#define OVERLOAD_RECOVERY_RATIO 0.7
+// Minimum time in overload before recovery, in milliseconds
+#define OVERLOAD_MIN_HOLD 5000
+// Interval of full batches measuring the script cost
+// while batches are passed through or dropped, in milliseconds
+#define OVERLOAD_PROBE_INTERVAL 1000
+
+/**
+ * OverloadControl class detects when the script cannot sustain
+ * the input and selects how to degrade.
+ *
+ * The script cost per reading and the arrival rate of readings
+ * are tracked as moving averages. The filter is overloaded when
+ * the projected processing time of a batch is over the latency
+ * objective or the script is busy more than the time between
+ * batches. While overloaded, batches are sampled (1 in N readings
+ * are filtered), passed onwards unfiltered or dropped, according
+ * to the policy. Normal processing resumes once the load is below
+ * OVERLOAD_RECOVERY_RATIO of the limits, after at least
+ * OVERLOAD_MIN_HOLD in overload.
+ */
+class OverloadControl
+{
+	public:
+		enum Policy { OVERLOAD_SAMPLE, OVERLOAD_PASSTHROUGH, OVERLOAD_DROP };
+		enum Action { ACTION_PROCESS, ACTION_SAMPLE, ACTION_PASS, ACTION_DROP };
+
+		OverloadControl();
+
+		void	setPolicy(unsigned long latency,
+				  const std::string& policy,
+				  unsigned long sampleRate);
+		bool	isActive() const { return m_latency != 0; };
+		bool	isOverloaded() const { return m_overloaded; };
+		uint64_t
+			getLatency() const { return m_latency; };
+		Action	admit(size_t readings);
+		void	sample(const std::vector<Reading *>& readings,
+			       std::vector<Reading *>& sampled);
+		void	batchDone(size_t readings, uint64_t usec);
+		void	addShed(unsigned long readings) { m_shed += readings; };
+		std::string
+			getLoad() const;
+		std::string
+			getStats() const;
+
+	private:
+		static uint64_t
+			now();
+		void	updateArrival(size_t readings, uint64_t tNow);
+
+	private:
+		// Latency objective of a batch, in microseconds
+		uint64_t	m_latency;
+		Policy		m_policy;
+		unsigned long	m_sampleRate;
+		bool		m_overloaded;
+		// Moving averages: script microseconds per reading
+		// and readings per second
+		double		m_cost;
+		double		m_arrivalRate;
+		// Load of last batch: projected microseconds
+		// and fraction of time the script is busy
+		double		m_projected;
+		double		m_busy;
+		uint64_t	m_lastArrival;
+		// Time of last change of state and last full batch
+		uint64_t	m_since;
+		uint64_t	m_lastProbe;
+		// Readings seen by sampling, across batches
+		unsigned long	m_sampleCount;
+		std::atomic<unsigned long>
+				m_transitions;
+		std::atomic<unsigned long>
+				m_shed;
+};
+#endif
@@ -0,0 +1,46 @@
+#ifndef _PRIORITY_SELECTOR_H
+#define _PRIORITY_SELECTOR_H
+/*
+ * FogLAMP "Python 3.5" filter, priority readings selection.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <reading.h>
+
+/**
+ * PrioritySelector class selects the readings of priority assets,
+ * i.e. alarms and trips, which are forwarded before the rest
+ * of the batch is passed to the script.
+ *
+ * Priority assets are set as a comma separated list of asset
+ * names or shell wildcard patterns, i.e. "trip,alarm_*".
+ */
+class PrioritySelector
+{
+	public:
+		PrioritySelector();
+
+		void	setPatterns(const std::string& patterns);
+		bool	isActive() const { return !m_patterns.empty(); };
+		bool	isPriority(const std::string& asset);
+		bool	select(const std::vector<Reading *>& readings,
+			       std::vector<Reading *>& priority,
+			       std::vector<Reading *>& bulk);
+
+	private:
+		std::vector<std::string>
+				m_patterns;
+		// Selection result by asset name
+		std::unordered_map<std::string, bool>
+				m_assets;
+};
+#endif
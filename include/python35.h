@@ -17,8 +17,47 @@
 
 #include <Python.h>
 
+#include "change_detector.h"
+#include "capture.h"
+#include "filter_module.h"
+#include "script_timer.h"
+#include "gc_policy.h"
+#include "script_profiler.h"
+#include "memory_accounting.h"
+#include "output_schema.h"
+#include "script_cache.h"
+#include "conversion_budget.h"
+#include "value_cache.h"
+#include "priority_selector.h"
+#include "filter_stats.h"
+#include "converters.h"
+#include "memory_reclaim.h"
+#include "container_pool.h"
+#include "overload_control.h"
+#include "script_call.h"
+
 // Relative path to FOGLAMP_DATA
 #define PYTHON_FILTERS_PATH "/scripts"
+// Size of first slice when reading cost is not known yet
+#define FIRST_SLICE_SIZE 500
+// Minimum number of readings in a slice
+#define MIN_SLICE_SIZE 10
+
+// Field offsets of reading record type
+#define READING_RECORD_ASSET_CODE	0
+#define READING_RECORD_READING		1
+#define READING_RECORD_ID		2
+#define READING_RECORD_TS		3
+#define READING_RECORD_USER_TS		4
+#define READING_RECORD_FIELDS		5
+
+// Reading record type, set by initReadingRecordType()
+extern PyTypeObject* readingRecordType;
+bool initReadingRecordType();
+void resetReadingRecordType();
+
+// Compiled scripts, released before Python finalisation
+extern ScriptCache scriptCache;
 
 /**
  * Python35Filter class is derived from FogLampFilter
@@ -37,9 +76,22 @@ class Python35Filter : public FogLampFilter
 					outHandle,
 					output)
 		{
+			m_categoryName = config.getName();
 			m_pModule = NULL;
-			m_pFunc = NULL;
+			m_pValueFunc = NULL;
+			m_priorityScript = false;
 			m_init = false;
+			m_gilHoldTime = 0;
+			m_readingCost = 0.0;
+			m_readingRecord = false;
+			m_groupByAsset = false;
+			m_timerInterval = 0;
+			m_scriptHash = 0;
+			m_moduleVersion = 0;
+			for (int i = 0; i < READING_RECORD_FIELDS; i++)
+			{
+				m_readingKeys[i] = NULL;
+			}
 		};
 
 		// Set the additional path for Python3.5 Foglamp scripts
@@ -50,23 +102,100 @@ class Python35Filter : public FogLampFilter
 		}
 		const std::string&
 			getFiltersPath() const { return m_filtersPath; };
+		// Configuration category name, kept across reconfigurations
+		const std::string&
+			getCategoryName() const { return m_categoryName; };
+		std::string
+			getScriptFile() const;
 		bool	setScriptName();
 		bool	configure();
 		bool	reconfigure(const std::string& newConfig);
+		void	setOptions(ConfigCategory& config);
 		void	lock() { m_configMutex.lock(); };
 		void	unlock() { m_configMutex.unlock(); };
 		void	logErrorMessage();
 		// Filtering methods for Reading objects
+		PyObject*
+			createReadingObject(Reading* reading);
 		PyObject*
 			createReadingsList(const std::vector<Reading *>& readings);
+		PyObject*
+			createReadingsGroups(const std::vector<Reading *>& readings,
+					     std::vector<size_t>& groups,
+					     std::vector<PyObject *>& assets);
+		PyObject*
+			ungroupReadings(PyObject* filteredData,
+					const std::vector<size_t>& groups,
+					const std::vector<PyObject *>& assets);
 		std::vector<Reading *>*
 			getFilteredReadings(PyObject* filteredData);
+		std::vector<Reading *>*
+			filterReadings(const std::vector<Reading *>& readings,
+				       bool overloaded,
+				       double deadline);
+		std::vector<Reading *>*
+			callScript(const std::vector<Reading *>& readings,
+				   ScriptCall& call,
+				   bool overloaded,
+				   double deadline);
+		std::vector<Reading *>*
+			mapValues(const std::vector<Reading *>& readings);
+		void	output(ReadingSet* readingSet);
+		bool	emit(PyObject* readings);
+		void	startTimers();
+		void	stopTimers()
+			{
+				m_timer.stop();
+				m_gcTimer.stop();
+				m_reclaimTimer.stop();
+				m_profiler.stop();
+			};
+		ScriptMetrics&
+			getMetrics() { return m_metrics; };
+		void	logMetrics();
+		void	captureReadings(const std::vector<Reading *>& readings)
+			{
+				m_capture.write(readings);
+			};
+		bool	detectChanges(const std::vector<Reading *>& readings,
+				      std::vector<Reading *>& changed);
+		void	commitChanges(const std::vector<Reading *>& readings);
+		bool	selectPriority(const std::vector<Reading *>& readings,
+				       std::vector<Reading *>& priority,
+				       std::vector<Reading *>& bulk);
+		ReadingSet*
+			filterPriority(const std::vector<Reading *>& priority,
+				       double arrival);
+		bool	passThrough(const std::vector<Reading *>& readings);
+		OverloadControl::Action
+			shedLoad(const std::vector<Reading *>& readings,
+				 std::vector<Reading *>& sampled,
+				 bool& overloaded,
+				 uint64_t& latency);
+		void	overloadDone(size_t readings, uint64_t usec);
+		FilterStats&
+			getFilterStats() { return m_stats; };
+		void	batchStarted() { m_reclaimer.batchStarted(); };
+		void	batchDone(size_t readings)
+			{
+				m_reclaimer.batchDone(readings);
+			};
+		std::string
+			renderStats();
+		void	releasePythonObjects();
 
 	public:
 		// Python 3.5 loaded filter module handle
 		PyObject*	m_pModule;
-		// Python 3.5 callable method handle
-		PyObject*	m_pFunc;
+		// Python 3.5 filter method and set_filter_config calls
+		ScriptCall	m_filterCall;
+		ScriptCall	m_configCall;
+		// Python 3.5 pure per datapoint method handle
+		PyObject*	m_pValueFunc;
+		// Python 3.5 priority readings method call
+		ScriptCall	m_priorityCall;
+		// Python 3.5 timer method call
+		ScriptCall	m_timerCall;
 		// Python 3.5  script name
 		std::string	m_pythonScript;
 		// Python interpreter has been started by this plugin
@@ -75,7 +204,83 @@ class Python35Filter : public FogLampFilter
 	private:
 		// Scripts path
 		std::string	m_filtersPath;
+		// Name of the configuration category of this filter instance
+		std::string	m_categoryName;
 		// Configuration lock
 		std::mutex	m_configMutex;
+		// Native deadband / change detection stage
+		ChangeDetector	m_changeDetector;
+		// Target GIL hold time in milliseconds, 0 for no slicing
+		unsigned long	m_gilHoldTime;
+		// Measured processing cost per reading, in microseconds
+		double		m_readingCost;
+		// Pass reading records instead of dicts to the script
+		bool		m_readingRecord;
+		// Pass a dict of asset code to list of readings to the script
+		bool		m_groupByAsset;
+		// Capture of ingested readings
+		CaptureWriter	m_capture;
+		// Counters and gauges set by the script
+		ScriptMetrics	m_metrics;
+		// Serialises calls to output stream
+		std::mutex	m_outputMutex;
+		// Script timer callback and its interval in milliseconds
+		ScriptTimer	m_timer;
+		unsigned long	m_timerInterval;
+		// Python garbage collection policy and its idle timer
+		GcPolicy	m_gcPolicy;
+		ScriptTimer	m_gcTimer;
+		// Sampling profiler of script calls
+		ScriptProfiler	m_profiler;
+		// Python memory accounting per batch
+		MemoryAccounting
+				m_memoryAccounting;
+		// Output schema declared by the script
+		OutputSchema	m_outputSchema;
+		// Content hash of the loaded script, 0 if unknown
+		uint64_t	m_scriptHash;
+		// Changed on each module load: script methods are resolved again
+		unsigned long	m_moduleVersion;
+		// Memory budget of Python conversions
+		ConversionBudget
+				m_conversionBudget;
+		// Results of pure per datapoint method
+		ValueCache	m_valueCache;
+		// Priority assets, forwarded before the others,
+		// optionally through the script priority method
+		PrioritySelector
+				m_prioritySelector;
+		bool		m_priorityScript;
+		// Post-burst memory reclamation and its timer
+		MemoryReclaimer	m_reclaimer;
+		ScriptTimer	m_reclaimTimer;
+		// Degradation when the script cannot sustain the input
+		OverloadControl	m_overloadControl;
+		// Recycled input dicts of readings and of their datapoints
+		ContainerPool	m_readingPool;
+		ContainerPool	m_datapointsPool;
+		// Interned keys of reading dicts, by record field index
+		PyObject*	m_readingKeys[READING_RECORD_FIELDS];
+		// Datapoint keys and values of the reading being converted
+		std::vector<std::pair<PyObject *, PyObject *>>
+				m_datapointItems;
+		// Performance counters
+		FilterStats	m_stats;
+		// Stats endpoint socket path, empty for no endpoint
+		std::string	m_statsSocket;
+		// Stats endpoint, declared last to be stopped first
+		StatsServer	m_statsServer;
+
+	private:
+		PyObject*
+			loadScript(bool reload);
+		DatapointValue*
+			callValueMethod(const std::string& asset,
+					const std::string& datapoint,
+					const DatapointValue& value);
+		void	onTimer();
+		void	onGcTimer();
+		void	onReclaimTimer();
+		void	recycleContainers();
 };
 #endif
@@ -0,0 +1,61 @@
+#ifndef _SCRIPT_CACHE_H
+#define _SCRIPT_CACHE_H
+/*
+ * FogLAMP "Python 3.5" filter, compiled script cache.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdint.h>
+#include <string>
+#include <deque>
+#include <unordered_map>
+
+#include <Python.h>
+
+// Maximum number of compiled scripts kept
+#define SCRIPT_CACHE_SIZE 32
+
+/**
+ * ScriptCache class keeps the compiled code objects of the
+ * filter scripts, keyed by hash of script content.
+ *
+ * Filter instances running scripts with the same content and
+ * reloads of a changed script compile the source only once.
+ *
+ * All methods except readScript must be called holding the GIL
+ */
+class ScriptCache
+{
+	public:
+		ScriptCache();
+
+		static bool
+			readScript(const std::string& fileName,
+				   std::string& source,
+				   uint64_t& hash);
+		PyObject*
+			getCode(uint64_t hash,
+				const std::string& source,
+				const std::string& fileName);
+		uint64_t
+			getLoaded(const std::string& moduleName) const;
+		void	setLoaded(const std::string& moduleName, uint64_t hash);
+		void	clear();
+
+	private:
+		std::unordered_map<uint64_t, PyObject*>
+				m_code;
+		// Hashes in insertion order, for eviction
+		std::deque<uint64_t>
+				m_order;
+		// Hash of code last executed in each module, shared
+		// by filter instances through sys.modules
+		std::unordered_map<std::string, uint64_t>
+				m_loaded;
+};
+#endif
@@ -0,0 +1,62 @@
+#ifndef _SCRIPT_CALL_H
+#define _SCRIPT_CALL_H
+/*
+ * FogLAMP "Python 3.5" filter, cached calls of script methods.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <Python.h>
+
+// Optional arguments after the first one, detected by name
+#define SCRIPT_CALL_CONTEXT_ARG "context"
+#define SCRIPT_CALL_DEADLINE_ARG "deadline"
+
+/**
+ * ScriptCall class holds a script method resolved once
+ * per module version and calls it with a reused argument tuple.
+ *
+ * The tuple is reused only if the method did not retain it,
+ * i.e. through *args, otherwise a new one is created for next call.
+ *
+ * Methods whose second and third positional arguments are named
+ * 'context' and 'deadline' get these optional arguments too.
+ *
+ * All methods must be called holding the GIL
+ */
+class ScriptCall
+{
+	public:
+		ScriptCall();
+
+		bool	resolve(PyObject* module,
+				unsigned long version,
+				const char* name,
+				bool extraArgs);
+		bool	isSet() const { return m_func != NULL; };
+		int	getExtraArgs() const { return m_extraArgs; };
+		PyObject*
+			call(PyObject* arg,
+			     PyObject* context = NULL,
+			     PyObject* deadline = NULL);
+		PyObject*
+			call();
+		void	clear();
+
+	private:
+		static int
+			countExtraArgs(PyObject* func);
+
+	private:
+		PyObject*	m_func;
+		// Module version the method has been resolved from, 0 if none
+		unsigned long	m_version;
+		int		m_extraArgs;
+		// Argument tuple with empty items, ready for next call
+		PyObject*	m_args;
+};
+#endif
@@ -0,0 +1,64 @@
+#ifndef _SCRIPT_PROFILER_H
+#define _SCRIPT_PROFILER_H
+/*
+ * FogLAMP "Python 3.5" filter, sampling profiler.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <chrono>
+
+#include <Python.h>
+
+#include "script_timer.h"
+
+/**
+ * ScriptProfiler class samples the Python frame stack
+ * of the thread calling the filter script from a timer thread.
+ *
+ * Samples are aggregated by stack and periodically written
+ * to a file in collapsed stack format, one line per stack:
+ *   outer_function (file);inner_function (file) count
+ * which can be passed to flamegraph tools.
+ */
+class ScriptProfiler
+{
+	public:
+		ScriptProfiler();
+
+		void	setProfile(bool enabled,
+				   unsigned long interval,
+				   const std::string& fileName);
+		void	start();
+		void	stop();
+		// Called holding the GIL around script calls
+		void	enterCall() { if (m_enabled) m_thread = PyThreadState_Get(); };
+		void	leaveCall() { m_thread = NULL; };
+
+	private:
+		void	sample();
+		void	write();
+
+	private:
+		bool		m_enabled;
+		// Sampling interval in milliseconds
+		unsigned long	m_interval;
+		std::string	m_fileName;
+		ScriptTimer	m_timer;
+		// Thread state of the thread calling the script
+		std::atomic<PyThreadState*>
+				m_thread;
+		// Number of samples by collapsed stack
+		std::map<std::string, unsigned long>
+				m_stacks;
+		std::chrono::steady_clock::time_point
+				m_lastWrite;
+};
+#endif
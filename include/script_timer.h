@@ -0,0 +1,46 @@
+#ifndef _SCRIPT_TIMER_H
+#define _SCRIPT_TIMER_H
+/*
+ * FogLAMP "Python 3.5" filter, periodic timer.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * ScriptTimer class calls a function at a fixed
+ * interval from its own thread, until stopped.
+ */
+class ScriptTimer
+{
+	public:
+		ScriptTimer();
+		~ScriptTimer();
+
+		void	start(unsigned long interval,
+			      std::function<void()> callback);
+		void	stop();
+
+	private:
+		void	run();
+
+	private:
+		std::thread*	m_thread;
+		std::mutex	m_mutex;
+		std::condition_variable
+				m_cv;
+		bool		m_running;
+		// Interval in milliseconds
+		unsigned long	m_interval;
+		std::function<void()>
+				m_callback;
+};
+#endif
@@ -0,0 +1,66 @@
+#ifndef _VALUE_CACHE_H
+#define _VALUE_CACHE_H
+/*
+ * FogLAMP "Python 3.5" filter, cache of per datapoint results.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+#include <reading.h>
+
+/**
+ * ValueCache class is a bounded LRU cache of the results of
+ * a pure per datapoint script method, keyed by
+ * (asset, datapoint, input value).
+ */
+class ValueCache
+{
+	public:
+		ValueCache();
+
+		void	setCapacity(unsigned long capacity);
+		bool	isActive() const { return m_capacity != 0; };
+		void	clear();
+		static std::string
+			makeKey(const std::string& asset,
+				const std::string& datapoint,
+				const DatapointValue& value);
+		bool	get(const std::string& key, DatapointValue** value);
+		void	put(const std::string& key, const DatapointValue& value);
+		std::string
+			getStats() const;
+
+	private:
+		class Entry
+		{
+			public:
+				Entry(const std::string& key,
+				      const DatapointValue& value) :
+					m_key(key),
+					m_value(value) {};
+				std::string	m_key;
+				DatapointValue	m_value;
+		};
+
+	private:
+		mutable std::mutex
+				m_mutex;
+		unsigned long	m_capacity;
+		// Most recently used entries first
+		std::list<Entry>
+				m_entries;
+		std::unordered_map<std::string, std::list<Entry>::iterator>
+				m_index;
+		unsigned long	m_hits;
+		unsigned long	m_misses;
+};
+#endif
@@ -0,0 +1,149 @@
+/*
+ * FogLAMP "Python 3.5" filter, Python memory accounting.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <logger.h>
+
+#include "memory_accounting.h"
+
+using namespace std;
+
+/**
+ * Constructor: accounting is not enabled
+ */
+MemoryAccounting::MemoryAccounting() : m_enabled(false),
+				       m_countObjects(false)
+{
+	this->setEnabled(false, false);
+}
+
+/**
+ * Enable or disable accounting and reset its state
+ *
+ * @param enabled	Whether accounting is enabled
+ * @param countObjects	Whether live objects are counted too
+ */
+void MemoryAccounting::setEnabled(bool enabled, bool countObjects)
+{
+	m_enabled = enabled;
+	m_countObjects = countObjects;
+	m_batches = 0;
+	m_blocksBefore = 0;
+	m_windowBlocks = m_windowObjects = -1;
+	m_driftBlocks = m_driftObjects = 0;
+	m_growingWindows = 0;
+}
+
+/**
+ * Get the number of allocated blocks of Python memory allocator
+ *
+ * @return	The number of blocks or -1 on errors
+ */
+Py_ssize_t MemoryAccounting::allocatedBlocks()
+{
+	// Borrowed reference
+	PyObject* func = PySys_GetObject((char *)"getallocatedblocks");
+	PyObject* ret = func ? PyObject_CallObject(func, NULL) : NULL;
+	Py_ssize_t blocks = ret ? PyLong_AsSsize_t(ret) : -1;
+	Py_CLEAR(ret);
+	PyErr_Clear();
+
+	return blocks;
+}
+
+/**
+ * Get the number of objects tracked by the garbage collector
+ *
+ * @return	The number of objects or -1 on errors
+ */
+Py_ssize_t MemoryAccounting::liveObjects()
+{
+	PyObject* gcModule = PyImport_ImportModule("gc");
+	PyObject* objects = gcModule ?
+			    PyObject_CallMethod(gcModule, (char *)"get_objects", NULL) :
+			    NULL;
+	Py_ssize_t count = objects ? PyList_Size(objects) : -1;
+	Py_CLEAR(objects);
+	Py_CLEAR(gcModule);
+	PyErr_Clear();
+
+	return count;
+}
+
+/**
+ * Save allocated blocks before a batch
+ */
+void MemoryAccounting::beforeBatch()
+{
+	if (m_enabled)
+	{
+		m_blocksBefore = this->allocatedBlocks();
+	}
+}
+
+/**
+ * Account memory retained by a batch and check for drift
+ * at the end of each window of batches
+ *
+ * @param filterName	The filter name for log messages
+ */
+void MemoryAccounting::afterBatch(const string& filterName)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	Py_ssize_t blocks = this->allocatedBlocks();
+	if (blocks > m_blocksBefore && m_blocksBefore >= 0)
+	{
+		Logger::getLogger()->debug("Filter '%s', batch retained %ld Python blocks",
+					   filterName.c_str(),
+					   (long)(blocks - m_blocksBefore));
+	}
+
+	if (++m_batches % MEMORY_WINDOW_BATCHES)
+	{
+		return;
+	}
+
+	// Objects are not counted: only blocks are checked
+	Py_ssize_t objects = m_countObjects ? this->liveObjects() : -1;
+	if (m_windowBlocks >= 0 &&
+	    blocks > m_windowBlocks &&
+	    (!m_countObjects || objects > m_windowObjects))
+	{
+		if (!m_growingWindows)
+		{
+			m_driftBlocks = m_windowBlocks;
+			m_driftObjects = m_windowObjects;
+		}
+		if (++m_growingWindows == MEMORY_DRIFT_WINDOWS)
+		{
+			Logger::getLogger()->warn("Filter '%s', Python memory grows across "
+						  "%d windows of %d batches: allocated blocks "
+						  "%ld -> %ld, live objects %ld -> %ld",
+						  filterName.c_str(),
+						  MEMORY_DRIFT_WINDOWS,
+						  MEMORY_WINDOW_BATCHES,
+						  (long)m_driftBlocks,
+						  (long)blocks,
+						  (long)m_driftObjects,
+						  (long)objects);
+			m_growingWindows = 0;
+		}
+	}
+	else
+	{
+		m_growingWindows = 0;
+	}
+
+	m_windowBlocks = blocks;
+	m_windowObjects = objects;
+}
@@ -0,0 +1,164 @@
+/*
+ * FogLAMP "Python 3.5" filter, post-burst memory reclamation.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <Python.h>
+
+#include "memory_reclaim.h"
+
+using namespace std;
+
+/**
+ * Constructor: reclamation is not active by default
+ */
+MemoryReclaimer::MemoryReclaimer() : m_batchSize(0),
+				     m_idleTime(0),
+				     m_pending(false),
+				     m_running(0),
+				     m_lastBatch(0),
+				     m_reclaims(0),
+				     m_reclaimed(0)
+{
+}
+
+/**
+ * Set the reclamation policy
+ *
+ * @param batchSize	Readings of a batch requesting reclamation,
+ *			0 disables it
+ * @param idleTime	Reclaim after any batch once idle for
+ *			this time in milliseconds, 0 disables it
+ */
+void MemoryReclaimer::setPolicy(unsigned long batchSize, unsigned long idleTime)
+{
+	m_batchSize = batchSize;
+	m_idleTime = idleTime;
+	m_pending = false;
+}
+
+/**
+ * Get the interval of reclamation checks
+ *
+ * @return	Interval in milliseconds
+ */
+unsigned long MemoryReclaimer::getCheckInterval() const
+{
+	unsigned long delay = m_idleTime ? m_idleTime : RECLAIM_DEFAULT_DELAY;
+	return delay > 1 ? delay / 2 : 1;
+}
+
+/**
+ * Record a processed batch, started by batchStarted()
+ *
+ * @param readings	Number of readings in the batch
+ */
+void MemoryReclaimer::batchDone(size_t readings)
+{
+	m_lastBatch = chrono::steady_clock::now().time_since_epoch().count();
+	if (m_running)
+	{
+		m_running--;
+	}
+	if (m_idleTime || (m_batchSize && readings >= m_batchSize))
+	{
+		m_pending = true;
+	}
+}
+
+/**
+ * Check whether reclamation is requested, no batch is
+ * running and none arrived for the idle time
+ *
+ * @return	True if memory has to be reclaimed now
+ */
+bool MemoryReclaimer::isDue()
+{
+	if (!m_pending || m_running)
+	{
+		return false;
+	}
+
+	unsigned long delay = m_idleTime ? m_idleTime : RECLAIM_DEFAULT_DELAY;
+	chrono::steady_clock::duration idle = chrono::steady_clock::now().time_since_epoch() -
+					      chrono::steady_clock::duration(m_lastBatch);
+	if (idle < chrono::milliseconds(delay))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Clear Python free lists with a full collection and trim the C heap,
+ * completing the pending reclamation request
+ *
+ * This method must be called holding the GIL, which is
+ * released while the heap is trimmed
+ *
+ * @return	Reclaimed resident memory in bytes, may be negative
+ */
+long MemoryReclaimer::reclaim()
+{
+	m_pending = false;
+	long before = residentSize();
+
+	// A full collection clears the free lists of builtin types
+	PyGC_Collect();
+	PyType_ClearCache();
+
+#ifdef __GLIBC__
+	Py_BEGIN_ALLOW_THREADS
+	malloc_trim(0);
+	Py_END_ALLOW_THREADS
+#endif
+
+	long reclaimed = before - residentSize();
+	m_reclaims++;
+	m_reclaimed += reclaimed;
+
+	return reclaimed;
+}
+
+/**
+ * Get current resident memory
+ *
+ * @return	Resident memory in bytes, 0 if not available
+ */
+long MemoryReclaimer::residentSize()
+{
+	long pages = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm)
+	{
+		if (fscanf(statm, "%*s %ld", &pages) != 1)
+		{
+			pages = 0;
+		}
+		fclose(statm);
+	}
+	return pages * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Get reclamation counters
+ *
+ * @return	Counters as text
+ */
+string MemoryReclaimer::getStats() const
+{
+	return "reclaims " + to_string(m_reclaims) +
+	       ", reclaimed " + to_string(m_reclaimed / 1024) + " KBytes";
+}
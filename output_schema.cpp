@@ -0,0 +1,243 @@
+/*
+ * FogLAMP "Python 3.5" filter, script output schema.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <logger.h>
+
+#include "output_schema.h"
+
+using namespace std;
+
+/**
+ * Constructor: no schema
+ */
+OutputSchema::OutputSchema() : m_rejected(0),
+			       m_repaired(0)
+{
+}
+
+/**
+ * Remove current schema
+ */
+void OutputSchema::clear()
+{
+	for (auto asset = m_assets.begin(); asset != m_assets.end(); ++asset)
+	{
+		for (auto field = asset->second.begin(); field != asset->second.end(); ++field)
+		{
+			Py_CLEAR(field->m_key);
+			Py_CLEAR(field->m_strKey);
+		}
+	}
+	m_assets.clear();
+}
+
+/**
+ * Compile the schema declared by the script
+ *
+ * @param schema	Python dict of asset name to dict of
+ *			datapoint name to type name
+ * @param makeKey	Function creating the dict key object
+ *			of a datapoint name
+ * @return		True on success, false if schema is not valid:
+ *			current schema is removed
+ */
+bool OutputSchema::compile(PyObject* schema,
+			   function<PyObject*(const string&)> makeKey)
+{
+	this->clear();
+
+	if (!PyDict_Check(schema))
+	{
+		return false;
+	}
+
+	PyObject *assetKey, *assetFields;
+	Py_ssize_t assetPos = 0;
+	while (PyDict_Next(schema, &assetPos, &assetKey, &assetFields))
+	{
+		const char* asset = PyUnicode_Check(assetKey) ? PyUnicode_AsUTF8(assetKey) : NULL;
+		if (!asset || !PyDict_Check(assetFields))
+		{
+			this->clear();
+			return false;
+		}
+
+		vector<Field>& fields = m_assets[asset];
+		fields.reserve(PyDict_Size(assetFields));
+
+		PyObject *name, *type;
+		Py_ssize_t pos = 0;
+		while (PyDict_Next(assetFields, &pos, &name, &type))
+		{
+			const char* fieldName = PyUnicode_Check(name) ? PyUnicode_AsUTF8(name) : NULL;
+			const char* typeName = PyUnicode_Check(type) ? PyUnicode_AsUTF8(type) : NULL;
+			if (!fieldName || !typeName)
+			{
+				this->clear();
+				return false;
+			}
+
+			Field field;
+			field.m_name = fieldName;
+			string fieldType(typeName);
+			if (fieldType.compare("int") == 0)
+			{
+				field.m_type = FIELD_INTEGER;
+			}
+			else if (fieldType.compare("float") == 0)
+			{
+				field.m_type = FIELD_FLOAT;
+			}
+			else if (fieldType.compare("str") == 0)
+			{
+				field.m_type = FIELD_STRING;
+			}
+			else
+			{
+				Logger::getLogger()->error("Output schema, asset '%s', datapoint '%s': "
+							   "unknown type '%s'",
+							   asset,
+							   fieldName,
+							   typeName);
+				this->clear();
+				return false;
+			}
+			field.m_key = makeKey(field.m_name);
+			field.m_strKey = PyUnicode_FromString(field.m_name.c_str());
+			fields.push_back(field);
+		}
+	}
+
+	PyErr_Clear();
+	return true;
+}
+
+/**
+ * Get the declared datapoints of an asset
+ *
+ * @param asset		The asset name
+ * @return		The datapoints or NULL if asset is not declared
+ */
+const vector<OutputSchema::Field>* OutputSchema::getFields(const string& asset) const
+{
+	auto it = m_assets.find(asset);
+	return it == m_assets.end() ? NULL : &it->second;
+}
+
+/**
+ * Decode the datapoints dict of a reading with declared asset
+ *
+ * Declared datapoints missing in the dict are skipped,
+ * datapoints which are not declared are ignored.
+ *
+ * @param asset		The asset name
+ * @param fields	The declared datapoints of the asset
+ * @param reading	The Python dict of datapoints
+ * @param newReading	Set to the new reading, NULL if no datapoints
+ * @param repaired	Incremented by the number of converted values
+ * @return		False if a value cannot be converted:
+ *			the reading is rejected
+ */
+bool OutputSchema::decode(const string& asset,
+			  const vector<Field>& fields,
+			  PyObject* reading,
+			  Reading** newReading,
+			  unsigned long& repaired)
+{
+	vector<Datapoint *> values;
+	values.reserve(fields.size());
+
+	for (auto field = fields.begin(); field != fields.end(); ++field)
+	{
+		// Borrowed reference
+		PyObject* value = PyDict_GetItem(reading, field->m_key);
+		if (!value && field->m_strKey)
+		{
+			value = PyDict_GetItem(reading, field->m_strKey);
+		}
+		if (!value)
+		{
+			continue;
+		}
+
+		DatapointValue* dataPoint = NULL;
+		switch (field->m_type)
+		{
+			case FIELD_INTEGER:
+				if (PyLong_Check(value))
+				{
+					dataPoint = new DatapointValue(PyLong_AsLong(value));
+				}
+				else if (PyFloat_Check(value))
+				{
+					dataPoint = new DatapointValue((long)PyFloat_AS_DOUBLE(value));
+					repaired++;
+				}
+				break;
+			case FIELD_FLOAT:
+				if (PyFloat_Check(value))
+				{
+					dataPoint = new DatapointValue(PyFloat_AS_DOUBLE(value));
+				}
+				else if (PyLong_Check(value))
+				{
+					dataPoint = new DatapointValue(PyLong_AsDouble(value));
+					repaired++;
+				}
+				break;
+			case FIELD_STRING:
+				if (PyBytes_Check(value))
+				{
+					dataPoint = new DatapointValue(string(PyBytes_AS_STRING(value),
+									      PyBytes_GET_SIZE(value)));
+				}
+				else if (PyUnicode_Check(value))
+				{
+					const char* text = PyUnicode_AsUTF8(value);
+					if (text)
+					{
+						dataPoint = new DatapointValue(string(text));
+						repaired++;
+					}
+				}
+				break;
+		}
+
+		if (!dataPoint || PyErr_Occurred())
+		{
+			// Value cannot be converted: reject the reading
+			PyErr_Clear();
+			delete dataPoint;
+			for (auto it = values.begin(); it != values.end(); ++it)
+			{
+				delete *it;
+			}
+			return false;
+		}
+
+		values.push_back(new Datapoint(field->m_name, *dataPoint));
+		delete dataPoint;
+	}
+
+	*newReading = values.empty() ? NULL : new Reading(asset, values);
+
+	return true;
+}
+
+/**
+ * Get totals of rejected readings and repaired values
+ *
+ * @return	The totals text
+ */
+string OutputSchema::getStats() const
+{
+	return "rejected readings " + to_string(m_rejected) +
+	       ", repaired values " + to_string(m_repaired);
+}
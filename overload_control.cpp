@@ -0,0 +1,232 @@
+/*
+ * FogLAMP "Python 3.5" filter, adaptive overload control.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdio.h>
+#include <chrono>
+
+#include "overload_control.h"
+
+using namespace std;
+
+/**
+ * Constructor: overload control is not active by default
+ */
+OverloadControl::OverloadControl() :
+				m_latency(0),
+				m_policy(OVERLOAD_SAMPLE),
+				m_sampleRate(10),
+				m_overloaded(false),
+				m_cost(0.0),
+				m_arrivalRate(0.0),
+				m_projected(0.0),
+				m_busy(0.0),
+				m_lastArrival(0),
+				m_since(0),
+				m_lastProbe(0),
+				m_sampleCount(0),
+				m_transitions(0),
+				m_shed(0)
+{
+}
+
+/**
+ * Set the latency objective and the policy under overload
+ *
+ * Disabling overload control resumes normal processing.
+ *
+ * @param latency	Latency objective of a batch in milliseconds,
+ *			0 disables overload control
+ * @param policy	The policy name: "sample", "passthrough" or "drop"
+ * @param sampleRate	Filter 1 reading every sampleRate readings
+ *			with sample policy
+ */
+void OverloadControl::setPolicy(unsigned long latency,
+				const string& policy,
+				unsigned long sampleRate)
+{
+	m_latency = (uint64_t)latency * 1000;
+	if (policy.compare("passthrough") == 0)
+	{
+		m_policy = OVERLOAD_PASSTHROUGH;
+	}
+	else if (policy.compare("drop") == 0)
+	{
+		m_policy = OVERLOAD_DROP;
+	}
+	else
+	{
+		m_policy = OVERLOAD_SAMPLE;
+	}
+	m_sampleRate = sampleRate ? sampleRate : 1;
+
+	if (!m_latency && m_overloaded)
+	{
+		m_overloaded = false;
+		m_transitions++;
+	}
+}
+
+/**
+ * Get current monotonic time
+ *
+ * @return	Time in microseconds
+ */
+uint64_t OverloadControl::now()
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().
+							   time_since_epoch()).count();
+}
+
+/**
+ * Update the arrival rate with a new batch
+ *
+ * @param readings	Number of readings in the batch
+ * @param tNow		Arrival time in microseconds
+ */
+void OverloadControl::updateArrival(size_t readings, uint64_t tNow)
+{
+	if (m_lastArrival)
+	{
+		uint64_t interval = tNow > m_lastArrival ? tNow - m_lastArrival : 1;
+		double rate = readings * 1000000.0 / interval;
+		m_arrivalRate = m_arrivalRate == 0.0 ?
+				rate :
+				m_arrivalRate + (rate - m_arrivalRate) * OVERLOAD_EWMA_WEIGHT;
+	}
+	m_lastArrival = tNow;
+}
+
+/**
+ * Check the load with a new batch and select its action
+ *
+ * @param readings	Number of readings to filter
+ * @return		The action for the batch:
+ *			process, sample, pass onwards unfiltered or drop
+ */
+OverloadControl::Action OverloadControl::admit(size_t readings)
+{
+	if (!m_latency)
+	{
+		return ACTION_PROCESS;
+	}
+
+	uint64_t tNow = now();
+	this->updateArrival(readings, tNow);
+
+	m_projected = m_cost * readings;
+	m_busy = m_arrivalRate * m_cost / 1000000.0;
+
+	if (!m_overloaded)
+	{
+		if (m_projected > m_latency || m_busy > 1.0)
+		{
+			m_overloaded = true;
+			m_since = tNow;
+			m_lastProbe = tNow;
+			m_transitions++;
+		}
+	}
+	else if (m_projected < m_latency * OVERLOAD_RECOVERY_RATIO &&
+		 m_busy < OVERLOAD_RECOVERY_RATIO &&
+		 tNow - m_since >= OVERLOAD_MIN_HOLD * 1000UL)
+	{
+		m_overloaded = false;
+		m_since = tNow;
+		m_transitions++;
+	}
+
+	if (!m_overloaded)
+	{
+		return ACTION_PROCESS;
+	}
+
+	if (m_policy == OVERLOAD_SAMPLE)
+	{
+		return ACTION_SAMPLE;
+	}
+
+	// Filter a full batch from time to time to measure the script cost
+	if (tNow - m_lastProbe >= OVERLOAD_PROBE_INTERVAL * 1000UL)
+	{
+		m_lastProbe = tNow;
+		return ACTION_PROCESS;
+	}
+
+	return m_policy == OVERLOAD_PASSTHROUGH ? ACTION_PASS : ACTION_DROP;
+}
+
+/**
+ * Select 1 reading every sample rate readings
+ *
+ * Sampling continues across batches, so that small
+ * batches are sampled too.
+ *
+ * @param readings	The input readings
+ * @param sampled	The output vector with readings to filter
+ */
+void OverloadControl::sample(const vector<Reading *>& readings,
+			     vector<Reading *>& sampled)
+{
+	sampled.reserve(readings.size() / m_sampleRate + 1);
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		if (m_sampleCount++ % m_sampleRate == 0)
+		{
+			sampled.push_back(*elem);
+		}
+	}
+}
+
+/**
+ * Record the script processing time of a batch
+ *
+ * @param readings	Number of filtered readings
+ * @param usec		Processing time in microseconds
+ */
+void OverloadControl::batchDone(size_t readings, uint64_t usec)
+{
+	if (!m_latency || !readings)
+	{
+		return;
+	}
+
+	double cost = (double)usec / readings;
+	m_cost = m_cost == 0.0 ? cost : m_cost + (cost - m_cost) * OVERLOAD_EWMA_WEIGHT;
+}
+
+/**
+ * Get current load, used when reporting a transition
+ *
+ * @return	The load text
+ */
+string OverloadControl::getLoad() const
+{
+	char load[160];
+	snprintf(load, sizeof(load),
+		 "projected batch time %.1f ms (objective %lu ms), "
+		 "script busy %.0f%%, arrival rate %.0f readings/s",
+		 m_projected / 1000.0,
+		 (unsigned long)(m_latency / 1000),
+		 m_busy * 100.0,
+		 m_arrivalRate);
+	return load;
+}
+
+/**
+ * Get overload control counters
+ *
+ * @return	The counters text
+ */
+string OverloadControl::getStats() const
+{
+	return string(m_overloaded ? "overloaded" : "normal") +
+	       ", transitions " + to_string(m_transitions) +
+	       ", shed readings " + to_string(m_shed);
+}
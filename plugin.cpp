@@ -18,6 +18,8 @@
 #include <strings.h>
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <sys/time.h>
 #include <filter_plugin.h>
 #include <filter.h>
 #include <version.h>
@@ -50,6 +52,7 @@ static void* libpython_handle = NULL;
  *
  * - readings_filter(readings) // Input is a dict
  *   It returns a dict with filtered input data
+ *   Optional 'context' and 'deadline' arguments can follow readings
  */
 
 // Filter default configuration
@@ -71,7 +74,210 @@ static void* libpython_handle = NULL;
 				"\"type\": \"script\", " \
 				"\"order\": \"1\", " \
 				"\"displayName\" : \"Python script\", " \
-				"\"default\": \"""\"} }"
+				"\"default\": \"""\"}, " \
+			"\"deadband\" : {\"description\" : \"Absolute change of a datapoint value " \
+					"below which a reading is not passed to the script, 0 disables it. " \
+					"With a percentage deadband too, a change over either is passed.\", " \
+				"\"type\": \"float\", " \
+				"\"order\": \"3\", " \
+				"\"displayName\" : \"Deadband\", " \
+				"\"default\": \"0\"}, " \
+			"\"deadbandPercent\" : {\"description\" : \"Percentage change of a datapoint value " \
+					"below which a reading is not passed to the script, 0 disables it.\", " \
+				"\"type\": \"float\", " \
+				"\"order\": \"4\", " \
+				"\"displayName\" : \"Deadband percentage\", " \
+				"\"default\": \"0\"}, " \
+			"\"minInterval\" : {\"description\" : \"Minimum interval in milliseconds " \
+					"between readings of the same asset, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"5\", " \
+				"\"displayName\" : \"Minimum interval\", " \
+				"\"default\": \"0\"}, " \
+			"\"gilHoldTime\" : {\"description\" : \"Target maximum time in milliseconds " \
+					"the Python interpreter lock is held: larger batches are " \
+					"passed to the script in slices, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"6\", " \
+				"\"displayName\" : \"GIL hold time\", " \
+				"\"default\": \"0\"}, " \
+			"\"readingFormat\" : {\"description\" : \"Representation of readings passed " \
+					"to the script: dict or compact read-only record with the same " \
+					"fields as attributes.\", " \
+				"\"type\": \"enumeration\", " \
+				"\"options\": [ \"dict\", \"record\" ], " \
+				"\"order\": \"7\", " \
+				"\"displayName\" : \"Reading format\", " \
+				"\"default\": \"dict\"}, " \
+			"\"captureFile\" : {\"description\" : \"File, relative to FogLAMP data " \
+					"directory, where ingested readings are captured for replay, " \
+					"empty disables capture.\", " \
+				"\"type\": \"string\", " \
+				"\"order\": \"8\", " \
+				"\"displayName\" : \"Capture file\", " \
+				"\"default\": \"\"}, " \
+			"\"captureMaxSize\" : {\"description\" : \"Maximum size in MBytes of " \
+					"capture file before rotation, 0 for no limit.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"9\", " \
+				"\"displayName\" : \"Capture file size\", " \
+				"\"default\": \"100\"}, " \
+			"\"captureFiles\" : {\"description\" : \"Number of rotated capture " \
+					"files to keep.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"10\", " \
+				"\"displayName\" : \"Capture files\", " \
+				"\"default\": \"2\"}, " \
+			"\"timerInterval\" : {\"description\" : \"Interval in milliseconds at which " \
+					"the script 'on_timer' method is called, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"11\", " \
+				"\"displayName\" : \"Timer interval\", " \
+				"\"default\": \"0\"}, " \
+			"\"gcPolicy\" : {\"description\" : \"Python garbage collection policy: " \
+					"default, batch (collect every number of batches or interval) " \
+					"or idle (collect when no batch arrives for idle time). " \
+					"With batch and idle automatic collection is disabled " \
+					"during script calls.\", " \
+				"\"type\": \"enumeration\", " \
+				"\"options\": [ \"default\", \"batch\", \"idle\" ], " \
+				"\"order\": \"12\", " \
+				"\"displayName\" : \"GC policy\", " \
+				"\"default\": \"default\"}, " \
+			"\"gcBatches\" : {\"description\" : \"Batch policy: number of batches " \
+					"between collections, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"13\", " \
+				"\"displayName\" : \"GC batches\", " \
+				"\"default\": \"100\"}, " \
+			"\"gcInterval\" : {\"description\" : \"Batch policy: interval in milliseconds " \
+					"between collections, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"14\", " \
+				"\"displayName\" : \"GC interval\", " \
+				"\"default\": \"10000\"}, " \
+			"\"gcIdleTime\" : {\"description\" : \"Idle policy: time in milliseconds " \
+					"without batches before a collection.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"15\", " \
+				"\"displayName\" : \"GC idle time\", " \
+				"\"default\": \"1000\"}, " \
+			"\"profile\" : {\"description\" : \"Sample the script call stack and write " \
+					"collapsed stacks to <category>_profile.folded in FogLAMP " \
+					"data directory.\", " \
+				"\"type\": \"boolean\", " \
+				"\"order\": \"16\", " \
+				"\"displayName\" : \"Profile script\", " \
+				"\"default\": \"false\"}, " \
+			"\"profileInterval\" : {\"description\" : \"Profiler sampling interval " \
+					"in milliseconds.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"17\", " \
+				"\"displayName\" : \"Profile interval\", " \
+				"\"default\": \"10\"}, " \
+			"\"memoryAccounting\" : {\"description\" : \"Account Python memory retained " \
+					"by each batch and alert when it grows across batches.\", " \
+				"\"type\": \"boolean\", " \
+				"\"order\": \"18\", " \
+				"\"displayName\" : \"Memory accounting\", " \
+				"\"default\": \"false\"}, " \
+			"\"memoryBudget\" : {\"description\" : \"Estimated memory in MBytes " \
+					"of readings converted into Python objects at the same time " \
+					"by all filters, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"19\", " \
+				"\"displayName\" : \"Memory budget\", " \
+				"\"default\": \"0\"}, " \
+			"\"memoryBudgetPolicy\" : {\"description\" : \"Batches over the memory " \
+					"budget are filtered in pieces (split) or passed onwards " \
+					"unfiltered (passthrough).\", " \
+				"\"type\": \"enumeration\", " \
+				"\"options\": [ \"split\", \"passthrough\" ], " \
+				"\"order\": \"20\", " \
+				"\"displayName\" : \"Memory budget policy\", " \
+				"\"default\": \"split\"}, " \
+			"\"valueCache\" : {\"description\" : \"Pure per datapoint mode: " \
+					"each value is mapped by script method " \
+					"'filter_value(asset, datapoint, value)' and up to this " \
+					"number of results are cached. 0 disables the mode.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"21\", " \
+				"\"displayName\" : \"Value cache size\", " \
+				"\"default\": \"0\"}, " \
+			"\"priorityAssets\" : {\"description\" : \"Comma separated list of " \
+					"asset names or wildcard patterns whose readings are " \
+					"forwarded before the rest of the batch.\", " \
+				"\"type\": \"string\", " \
+				"\"order\": \"22\", " \
+				"\"displayName\" : \"Priority assets\", " \
+				"\"default\": \"\"}, " \
+			"\"priorityScript\" : {\"description\" : \"Filter priority readings " \
+					"with script method 'priority', otherwise they are " \
+					"forwarded unfiltered.\", " \
+				"\"type\": \"boolean\", " \
+				"\"order\": \"23\", " \
+				"\"displayName\" : \"Priority script\", " \
+				"\"default\": \"false\"}, " \
+			"\"statsSocket\" : {\"description\" : \"Unix domain socket, relative " \
+					"to FogLAMP data directory, serving filter counters " \
+					"in Prometheus text format. Empty disables it.\", " \
+				"\"type\": \"string\", " \
+				"\"order\": \"24\", " \
+				"\"displayName\" : \"Stats socket\", " \
+				"\"default\": \"\"}, " \
+			"\"reclaimBatchSize\" : {\"description\" : \"Return memory to the " \
+					"system once idle after batches with at least this number " \
+					"of readings, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"25\", " \
+				"\"displayName\" : \"Reclaim batch size\", " \
+				"\"default\": \"0\"}, " \
+			"\"reclaimIdleTime\" : {\"description\" : \"Return memory to the " \
+					"system when no batch arrives for this time in " \
+					"milliseconds, 0 disables it.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"26\", " \
+				"\"displayName\" : \"Reclaim idle time\", " \
+				"\"default\": \"0\"}, " \
+			"\"groupByAsset\" : {\"description\" : \"Pass the script a dict of " \
+					"asset code to list of readings and get the same back. " \
+					"Readings are passed onwards in the input order.\", " \
+				"\"type\": \"boolean\", " \
+				"\"order\": \"27\", " \
+				"\"displayName\" : \"Group by asset\", " \
+				"\"default\": \"false\"}, " \
+			"\"overloadLatency\" : {\"description\" : \"Latency objective in " \
+					"milliseconds of a batch: when the script cannot sustain it " \
+					"the filter degrades according to the overload policy, " \
+					"0 disables overload control.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"28\", " \
+				"\"displayName\" : \"Overload latency\", " \
+				"\"default\": \"0\"}, " \
+			"\"overloadPolicy\" : {\"description\" : \"Under overload filter " \
+					"a sample of readings (sample), pass readings onwards " \
+					"unfiltered (passthrough) or drop readings of assets not " \
+					"in priority assets (drop).\", " \
+				"\"type\": \"enumeration\", " \
+				"\"options\": [ \"sample\", \"passthrough\", \"drop\" ], " \
+				"\"order\": \"29\", " \
+				"\"displayName\" : \"Overload policy\", " \
+				"\"default\": \"sample\"}, " \
+			"\"overloadSampleRate\" : {\"description\" : \"With sample policy " \
+					"filter 1 reading every this number of readings, " \
+					"the others are dropped.\", " \
+				"\"type\": \"integer\", " \
+				"\"order\": \"30\", " \
+				"\"displayName\" : \"Overload sample rate\", " \
+				"\"default\": \"10\"}, " \
+			"\"memoryObjects\" : {\"description\" : \"With memory accounting, " \
+					"also count objects tracked by the garbage collector " \
+					"every 100 batches. Diagnostic only: it walks the " \
+					"whole Python heap.\", " \
+				"\"type\": \"boolean\", " \
+				"\"order\": \"31\", " \
+				"\"displayName\" : \"Count live objects\", " \
+				"\"default\": \"false\"} }"
 using namespace std;
 
 /**
@@ -176,6 +382,9 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 	// Remove temp object
 	Py_CLEAR(pPath);
 
+	// Add foglamp_filter module for scripts
+	initFilterModule();
+
 	// Check first we have a Python script to load
 	if (!pyFilter->setScriptName())
 	{
@@ -190,6 +399,7 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 
 	// Configure filter
 	pyFilter->lock();
+	pyFilter->setOptions(*config);
 	bool ret = pyFilter->configure();
 	pyFilter->unlock();
 
@@ -199,7 +409,9 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 		if (pyFilter->m_init)
 		{
 			pyFilter->m_init = false;
+			scriptCache.clear();
 			Py_Finalize();
+			resetReadingRecordType();
 
 			if (libpython_handle)
 			{
@@ -210,10 +422,67 @@ PLUGIN_HANDLE plugin_init(ConfigCategory* config,
 
 	PyGILState_Release(state); // release GIL
 
+	if (ret)
+	{
+		// Start timers, if set
+		pyFilter->startTimers();
+	}
+
 	// return NULL aborts the filter pipeline set up
 	return ret ? (PLUGIN_HANDLE)info : NULL;
 }
 
+/**
+ * Record the end of a batch, whatever its outcome
+ *
+ * @param filter	The filter
+ * @param tStart	The batch arrival time
+ * @param readings	Number of input readings
+ */
+static void ingestDone(Python35Filter* filter,
+		       const chrono::steady_clock::time_point& tStart,
+		       size_t readings)
+{
+	uint64_t usec = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() -
+								    tStart).count();
+	filter->getFilterStats().addLatency(usec);
+	filter->batchDone(readings);
+}
+
+/**
+ * Get the readings to pass onwards unfiltered
+ *
+ * If priority readings have already been forwarded
+ * the input set is replaced by a copy of the other readings
+ *
+ * @param readingSet	The input reading set
+ * @param readings	The input readings without priority ones
+ * @param hasPriority	True if priority readings have been forwarded
+ * @return		The reading set to pass onwards
+ */
+static ReadingSet* unfilteredSet(ReadingSet* readingSet,
+				 const vector<Reading *>& readings,
+				 bool hasPriority)
+{
+	if (!hasPriority)
+	{
+		return readingSet;
+	}
+
+	vector<Reading *>* copies = new vector<Reading *>();
+	copies->reserve(readings.size());
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		copies->push_back(new Reading(**elem));
+	}
+	delete readingSet;
+
+	ReadingSet* newSet = new ReadingSet(copies);
+	delete copies;
+
+	return newSet;
+}
+
 /**
  * Ingest a set of readings into the plugin for processing
  *
@@ -228,6 +497,16 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 {
 	FILTER_INFO *info = (FILTER_INFO *) handle;
 	Python35Filter *filter = info->handle;
+	auto tStart = chrono::steady_clock::now();
+	FilterStats& stats = filter->getFilterStats();
+
+	// Arrival wall clock time, as time.time(), for script deadlines
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	double arrival = now.tv_sec + now.tv_usec / 1000000.0;
+
+	// Save incoming readings if capture is active
+	filter->captureReadings(((ReadingSet *)readingSet)->getAllReadings());
 
 	// Protect against reconfiguration
 	filter->lock();
@@ -237,118 +516,157 @@ void plugin_ingest(PLUGIN_HANDLE *handle,
 	if (!enabled)
 	{
 		// Current filter is not active: just pass the readings set
-		filter->m_func(filter->m_data, readingSet);
+		filter->output((ReadingSet *)readingSet);
 		return;
 	}
 
         // Get all the readings in the readingset
-	const vector<Reading *>& readings = ((ReadingSet *)readingSet)->getAllReadings();
-	for (vector<Reading *>::const_iterator elem = readings.begin();
-						      elem != readings.end();
+	const vector<Reading *>& allReadings = ((ReadingSet *)readingSet)->getAllReadings();
+	stats.addBatch(allReadings.size());
+	// No memory reclamation until ingestDone()
+	filter->batchStarted();
+
+	for (vector<Reading *>::const_iterator elem = allReadings.begin();
+						      elem != allReadings.end();
 						      ++elem)
 	{
 		AssetTracker::getAssetTracker()->addAssetTrackingTuple(info->configCatName,
 									(*elem)->getAssetName(),
 									string("Filter"));
 	}
-	
-	/**
-	 * 1 - create a Python object (list of dicts) from input data
-	 * 2 - pass Python object to Python filter method
-	 * 3 - Transform results from fealter into new ReadingSet
-	 * 4 - Remove old data and pass new data set onwards
-	 */
-
-	PyGILState_STATE state = PyGILState_Ensure();
 
-	// - 1 - Create Python list of dicts as input to the filter
-	PyObject* readingsList = filter->createReadingsList(readings);
-
-	// Check for errors
-	if (!readingsList)
+	// Forward priority readings before the rest of the batch
+	vector<Reading *> priority;
+	vector<Reading *> bulk;
+	bool hasPriority = filter->selectPriority(allReadings, priority, bulk);
+	if (hasPriority)
 	{
-		// Errors while creating Python 3.5 filter input object
-		Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
-					   "create filter data error, action: %s",
-					   FILTER_NAME,
-					   filter->getConfig().getName().c_str(),
-					   filter->m_pythonScript.c_str(),
-					  "pass unfiltered data onwards");
+		ReadingSet* prioritySet = filter->filterPriority(priority, arrival);
+		const vector<Reading *>& priorityReadings = prioritySet->getAllReadings();
+		for (vector<Reading *>::const_iterator elem = priorityReadings.begin();
+							      elem != priorityReadings.end();
+							      ++elem)
+		{
+			AssetTracker::getAssetTracker()->addAssetTrackingTuple(info->configCatName,
+										(*elem)->getAssetName(),
+										string("Filter"));
+		}
+		stats.addReadingsOut(priorityReadings.size());
+		filter->output(prioritySet);
+	}
+	const vector<Reading *>& input = hasPriority ? bulk : allReadings;
+
+	// Remove readings within deadband before Python conversion
+	vector<Reading *> changed;
+	const vector<Reading *>& readings = filter->detectChanges(input, changed) ?
+					    changed :
+					    input;
+	stats.addDrops(input.size() - readings.size());
+	if (readings.empty() && !allReadings.empty())
+	{
+		// Nothing to pass to the script and onwards
+		delete (ReadingSet *)readingSet;
+		ingestDone(filter, tStart, allReadings.size());
+		return;
+	}
 
-		// Pass data set to next filter and return
-		filter->m_func(filter->m_data, readingSet);
-		PyGILState_Release(state);
+	// Degrade under overload: sample, pass onwards unfiltered or drop
+	vector<Reading *> sampled;
+	bool overloaded;
+	uint64_t latency;
+	OverloadControl::Action action = filter->shedLoad(readings,
+							  sampled,
+							  overloaded,
+							  latency);
+	if (action == OverloadControl::ACTION_PASS)
+	{
+		stats.addReadingsOut(input.size());
+		ReadingSet* passSet = unfilteredSet((ReadingSet *)readingSet, input, hasPriority);
+		ingestDone(filter, tStart, allReadings.size());
+		filter->output(passSet);
+		return;
+	}
+	if (action == OverloadControl::ACTION_DROP ||
+	    (action == OverloadControl::ACTION_SAMPLE && sampled.empty()))
+	{
+		delete (ReadingSet *)readingSet;
+		ingestDone(filter, tStart, allReadings.size());
 		return;
 	}
+	const vector<Reading *>& batch = action == OverloadControl::ACTION_SAMPLE ?
+					 sampled :
+					 readings;
 
-	// - 2 - Call Python method passing an object
-	PyObject* pReturn = PyObject_CallFunction(filter->m_pFunc,
-						  (char *)string("O").c_str(),
-						  readingsList);
+	// Batch over the memory budget: pass it onwards unfiltered
+	if (filter->passThrough(batch))
+	{
+		stats.addReadingsOut(input.size());
+		ReadingSet* passSet = unfilteredSet((ReadingSet *)readingSet, input, hasPriority);
+		ingestDone(filter, tStart, allReadings.size());
+		filter->output(passSet);
+		return;
+	}
 
-	// Free filter input data
-	Py_CLEAR(readingsList);
+	/**
+	 * 1 - create a Python object (list of dicts) from input data
+	 * 2 - pass Python object to Python filter method
+	 * 3 - Transform results from fealter into new ReadingSet
+	 * 4 - Remove old data and pass new data set onwards
+	 *
+	 * Steps 1 to 3 are done by filterReadings, holding the GIL
+	 * for each slice of the input readings
+	 */
 
 	ReadingSet* finalData = NULL;
 
-	// - 3 - Handle filter returned data
-	if (!pReturn)
+	// Get new set of readings from Python filter
+	auto tFilter = chrono::steady_clock::now();
+	double deadline = latency ? arrival + latency / 1000000.0 : 0.0;
+	vector<Reading *>* newReadings = filter->filterReadings(batch, overloaded, deadline);
+	filter->overloadDone(batch.size(),
+			     chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() -
+									 tFilter).count());
+	if (newReadings)
 	{
-		// Errors while getting result object
-		Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
-					   "filter error, action: %s",
-					   FILTER_NAME,
-					   filter->getConfig().getName().c_str(),
-					   filter->m_pythonScript.c_str(),
-					   "pass unfiltered data onwards");
+		// Filter success
+		// - Save last values of changed readings, unless sampled
+		if (action == OverloadControl::ACTION_PROCESS)
+		{
+			filter->commitChanges(readings);
+		}
 
-		// Errors while getting result object
-		filter->logErrorMessage();
+		// - Delete input data as we have a new set
+		delete (ReadingSet *)readingSet;
+		readingSet = NULL;
 
-		// Filter did nothing: just pass input data
-		finalData = (ReadingSet *)readingSet;
-	}
-	else
-	{
-		// Get new set of readings from Python filter
-		vector<Reading *>* newReadings = filter->getFilteredReadings(pReturn);
-		if (newReadings)
-		{
-			// Filter success
-			// - Delete input data as we have a new set
-			delete (ReadingSet *)readingSet;
-			readingSet = NULL;
-
-			// - Set new readings with filtered/modified data
-			finalData = new ReadingSet(newReadings);
-
-			const vector<Reading *>& readings2 = finalData->getAllReadings();
-			for (vector<Reading *>::const_iterator elem = readings2.begin();
-								      elem != readings2.end();
-								      ++elem)
-			{
-				AssetTracker::getAssetTracker()->addAssetTrackingTuple(info->configCatName,
-											(*elem)->getAssetName(),
-											string("Filter"));
-			}
+		// - Set new readings with filtered/modified data
+		finalData = new ReadingSet(newReadings);
 
-			// - Remove newReadings pointer
-			delete newReadings;
-		}
-		else
+		const vector<Reading *>& readings2 = finalData->getAllReadings();
+		for (vector<Reading *>::const_iterator elem = readings2.begin();
+							      elem != readings2.end();
+							      ++elem)
 		{
-			// Filtered data error: use current reading set
-			finalData = (ReadingSet *)readingSet;
+			AssetTracker::getAssetTracker()->addAssetTrackingTuple(info->configCatName,
+										(*elem)->getAssetName(),
+										string("Filter"));
 		}
 
-		// Remove pReturn object
-		Py_CLEAR(pReturn);
+		// - Remove newReadings pointer
+		delete newReadings;
+	}
+	else
+	{
+		// Filter did nothing: just pass input data
+		finalData = unfilteredSet((ReadingSet *)readingSet, input, hasPriority);
+		stats.addError();
 	}
 
-	PyGILState_Release(state);
+	stats.addReadingsOut(finalData->getCount());
+	ingestDone(filter, tStart, allReadings.size());
 
 	// - 4 - Pass (new or old) data set to next filter
-	filter->m_func(filter->m_data, finalData);
+	filter->output(finalData);
 }
 
 /**
@@ -361,20 +679,37 @@ void plugin_shutdown(PLUGIN_HANDLE *handle)
 	FILTER_INFO *info = (FILTER_INFO *) handle;
 	Python35Filter* filter = info->handle;
 
+	// Stop timers before releasing Python objects
+	filter->stopTimers();
+
+	// Report script counters and gauges
+	filter->logMetrics();
+
 	PyGILState_STATE state = PyGILState_Ensure();
 
-	// Decrement pFunc reference count
-	Py_CLEAR(filter->m_pFunc);
+	// Release script methods
+	filter->m_filterCall.clear();
+	filter->m_configCall.clear();
+	Py_CLEAR(filter->m_pValueFunc);
+	filter->m_priorityCall.clear();
+	filter->m_timerCall.clear();
 		
 	// Decrement pModule reference count
 	Py_CLEAR(filter->m_pModule);
 
+	// Release output schema keys and recycled containers
+	filter->releasePythonObjects();
+
 	// Cleanup Python 3.5
 	if (filter->m_init)
 	{
 		filter->m_init = false;
 
+		// Release compiled scripts
+		scriptCache.clear();
+
 		Py_Finalize();
+		resetReadingRecordType();
 
 		if (libpython_handle)
 		{
@@ -404,7 +739,13 @@ void plugin_reconfigure(PLUGIN_HANDLE *handle, const string& newConfig)
 	FILTER_INFO *info = (FILTER_INFO *) handle;
 	Python35Filter* filter = info->handle;
 
+	// Timer threads need the GIL: stop them during reconfiguration
+	filter->stopTimers();
+
 	filter->reconfigure(newConfig);
+
+	// Start timers with new configuration, if set
+	filter->startTimers();
 }
 
 // End of extern "C"
@@ -0,0 +1,110 @@
+/*
+ * FogLAMP "Python 3.5" filter, priority readings selection.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <fnmatch.h>
+#include <sstream>
+
+#include "priority_selector.h"
+
+// Maximum number of asset names with a cached selection result
+#define PRIORITY_MAX_ASSETS 10000
+
+using namespace std;
+
+/**
+ * Constructor: no priority assets by default
+ */
+PrioritySelector::PrioritySelector()
+{
+}
+
+/**
+ * Set the priority asset names and patterns
+ *
+ * @param patterns	Comma separated list of asset names
+ *			or patterns, empty for none
+ */
+void PrioritySelector::setPatterns(const string& patterns)
+{
+	m_patterns.clear();
+	m_assets.clear();
+
+	stringstream list(patterns);
+	string pattern;
+	while (getline(list, pattern, ','))
+	{
+		// Remove surrounding spaces
+		size_t first = pattern.find_first_not_of(" \t");
+		size_t last = pattern.find_last_not_of(" \t");
+		if (first != string::npos)
+		{
+			m_patterns.push_back(pattern.substr(first, last - first + 1));
+		}
+	}
+}
+
+/**
+ * Check whether an asset is a priority one
+ *
+ * @param asset		The asset name
+ * @return		True if asset matches any name or pattern
+ */
+bool PrioritySelector::isPriority(const string& asset)
+{
+	auto it = m_assets.find(asset);
+	if (it != m_assets.end())
+	{
+		return it->second;
+	}
+
+	bool priority = false;
+	for (auto p = m_patterns.begin(); p != m_patterns.end() && !priority; ++p)
+	{
+		priority = fnmatch(p->c_str(), asset.c_str(), 0) == 0;
+	}
+
+	if (m_assets.size() >= PRIORITY_MAX_ASSETS)
+	{
+		m_assets.clear();
+	}
+	m_assets[asset] = priority;
+
+	return priority;
+}
+
+/**
+ * Split readings into priority and bulk ones,
+ * keeping the order of each part
+ *
+ * @param readings	The input readings
+ * @param priority	The output vector with priority readings
+ * @param bulk		The output vector with other readings
+ * @return		True if any priority reading has been found
+ */
+bool PrioritySelector::select(const vector<Reading *>& readings,
+			      vector<Reading *>& priority,
+			      vector<Reading *>& bulk)
+{
+	bulk.reserve(readings.size());
+
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		if (this->isPriority((*elem)->getAssetName()))
+		{
+			priority.push_back(*elem);
+		}
+		else
+		{
+			bulk.push_back(*elem);
+		}
+	}
+
+	return !priority.empty();
+}
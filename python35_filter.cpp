@@ -10,23 +10,263 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <sys/time.h>
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
 
 #define PYTHON_SCRIPT_METHOD_PREFIX "_script_"
 #define PYTHON_SCRIPT_FILENAME_EXTENSION ".py"
 #define SCRIPT_CONFIG_ITEM_NAME "script"
 // Filter configuration method
 #define DEFAULT_FILTER_CONFIG_METHOD "set_filter_config"
+// Optional timer callback method
+#define DEFAULT_FILTER_TIMER_METHOD "on_timer"
+// Default method for priority readings
+#define DEFAULT_FILTER_PRIORITY_METHOD "priority"
+// Optional pure per datapoint method
+#define DEFAULT_FILTER_VALUE_METHOD "filter_value"
+// Optional output schema declaration
+#define DEFAULT_FILTER_SCHEMA_VARIABLE "output_schema"
+
+#include <utils.h>
 
 #include "python35.h"
 
 using namespace std;
 
 /**
- * Create a Python 3.5 object (list of dicts)
- * to be passed to Python 3.5 loaded filter
+ * Reading record type: a struct sequence with
+ * the same fields of the reading dict
+ */
+static PyStructSequence_Field readingRecordFields[] = {
+	{(char *)"asset_code", (char *)"Asset name"},
+	{(char *)"reading", (char *)"Dict of reading datapoints"},
+	{(char *)"id", (char *)"Reading id"},
+	{(char *)"ts", (char *)"Reading timestamp"},
+	{(char *)"user_ts", (char *)"Reading user timestamp"},
+	{NULL, NULL}
+};
+
+static PyStructSequence_Desc readingRecordDesc = {
+	(char *)"foglamp.reading",
+	(char *)"FogLAMP reading record",
+	readingRecordFields,
+	READING_RECORD_FIELDS
+};
+
+// Compiled scripts of all filter instances
+ScriptCache scriptCache;
+
+// Statically allocated type, initialised once
+static PyTypeObject readingRecordTypeObject;
+PyTypeObject* readingRecordType = NULL;
+
+/**
+ * Initialise the reading record type, if not done yet
+ *
+ * This method must be called holding the GIL
+ *
+ * @return	True on success, false on errors
+ */
+bool initReadingRecordType()
+{
+	if (!readingRecordType)
+	{
+		if (PyStructSequence_InitType2(&readingRecordTypeObject,
+					       &readingRecordDesc) != 0)
+		{
+			PyErr_Clear();
+			Logger::getLogger()->error("Cannot initialise Python 3.5 "
+						   "reading record type");
+			return false;
+		}
+		readingRecordType = &readingRecordTypeObject;
+	}
+	return true;
+}
+
+/**
+ * Reset the reading record type, so that it is initialised
+ * again by a new interpreter: the type cannot be initialised
+ * twice.
+ *
+ * This method must be called after Py_Finalize()
+ */
+void resetReadingRecordType()
+{
+	readingRecordType = NULL;
+	memset(&readingRecordTypeObject, 0, sizeof(readingRecordTypeObject));
+}
+
+/**
+ * Create the Python 3.5 object of a reading: a dict or a reading record
+ *
+ * @param reading	The input reading
+ * @return		New reference to the reading object
+ */
+PyObject* Python35Filter::createReadingObject(Reading* reading)
+{
+	// Create object (dict) for reading Datapoints:
+	// this will be added as vale for key 'readings'.
+	// A recycled dict still has the keys of its previous reading
+	PyObject* newDataPoints = m_datapointsPool.getDict();
+	if (!newDataPoints)
+	{
+		return NULL;
+	}
+
+	// Get all datapoints
+	std::vector<Datapoint *>& dataPoints = reading->getReadingData();
+	m_datapointItems.clear();
+	for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
+	{
+		PyObject* value = datapointToPython((*it)->getData());
+		if (!value)
+		{
+			// Unknown type: skip datapoint
+			PyErr_Clear();
+			continue;
+		}
+
+		// Add Datapoint: key and value
+		PyObject* key = nameToPython((*it)->getName());
+		if (!key)
+		{
+			// Allocation error: fail the reading
+			Py_DECREF(value);
+			for (auto item = m_datapointItems.begin();
+			     item != m_datapointItems.end();
+			     ++item)
+			{
+				Py_DECREF(item->first);
+				Py_DECREF(item->second);
+			}
+			m_datapointItems.clear();
+			Py_DECREF(newDataPoints);
+			return NULL;
+		}
+		PyDict_SetItem(newDataPoints,
+				key,
+				value);
+		m_datapointItems.push_back(make_pair(key, value));
+	}
+
+	// Keys of previous reading left: set datapoints again
+	if (PyDict_Size(newDataPoints) != (Py_ssize_t)m_datapointItems.size())
+	{
+		ContainerPool::refill(newDataPoints, m_datapointItems);
+	}
+	for (auto it = m_datapointItems.begin(); it != m_datapointItems.end(); ++it)
+	{
+		Py_DECREF(it->first);
+		Py_DECREF(it->second);
+	}
+	m_datapointItems.clear();
+
+	// Add reading asset name
+	PyObject* assetVal = nameToPython(reading->getAssetName());
+
+	/**
+	 * Save id, timestamp and user_timestamp
+	 */
+
+	// Add reading id
+	PyObject* readingId = PyLong_FromUnsignedLong(reading->getId());
+
+	// Add reading timestamp
+	PyObject* readingTs = PyLong_FromUnsignedLong(reading->getTimestamp());
+
+	// Add reading user timestamp
+	PyObject* readingUserTs = PyLong_FromUnsignedLong(reading->getUserTimestamp());
+
+	if (!assetVal || !readingId || !readingTs || !readingUserTs)
+	{
+		Py_CLEAR(newDataPoints);
+		Py_CLEAR(assetVal);
+		Py_CLEAR(readingId);
+		Py_CLEAR(readingTs);
+		Py_CLEAR(readingUserTs);
+		return NULL;
+	}
+
+	if (m_readingRecord)
+	{
+		// Set record fields: references are stolen
+		PyObject* record = PyStructSequence_New(readingRecordType);
+		if (!record)
+		{
+			Py_CLEAR(newDataPoints);
+			Py_CLEAR(assetVal);
+			Py_CLEAR(readingId);
+			Py_CLEAR(readingTs);
+			Py_CLEAR(readingUserTs);
+			return NULL;
+		}
+		PyStructSequence_SET_ITEM(record, READING_RECORD_ASSET_CODE, assetVal);
+		PyStructSequence_SET_ITEM(record, READING_RECORD_READING, newDataPoints);
+		PyStructSequence_SET_ITEM(record, READING_RECORD_ID, readingId);
+		PyStructSequence_SET_ITEM(record, READING_RECORD_TS, readingTs);
+		PyStructSequence_SET_ITEM(record, READING_RECORD_USER_TS, readingUserTs);
+
+		return record;
+	}
+
+	// Create an object (dict) with 'asset_code' and 'readings' key,
+	// overwriting the values of a recycled one
+	bool keys = true;
+	for (int i = 0; i < READING_RECORD_FIELDS; i++)
+	{
+		if (!m_readingKeys[i])
+		{
+			m_readingKeys[i] = PyUnicode_InternFromString(readingRecordFields[i].name);
+			keys = keys && m_readingKeys[i];
+		}
+	}
+	PyObject* values[READING_RECORD_FIELDS];
+	values[READING_RECORD_ASSET_CODE] = assetVal;
+	values[READING_RECORD_READING] = newDataPoints;
+	values[READING_RECORD_ID] = readingId;
+	values[READING_RECORD_TS] = readingTs;
+	values[READING_RECORD_USER_TS] = readingUserTs;
+
+	PyObject* readingObject = keys ? m_readingPool.getDict() : NULL;
+	if (readingObject)
+	{
+		for (int i = 0; i < READING_RECORD_FIELDS; i++)
+		{
+			PyDict_SetItem(readingObject, m_readingKeys[i], values[i]);
+		}
+
+		// Keys added by the script to the recycled dict
+		if (PyDict_Size(readingObject) != READING_RECORD_FIELDS)
+		{
+			vector<pair<PyObject *, PyObject *>> items;
+			for (int i = 0; i < READING_RECORD_FIELDS; i++)
+			{
+				items.push_back(make_pair(m_readingKeys[i], values[i]));
+			}
+			ContainerPool::refill(readingObject, items);
+		}
+	}
+
+	// Remove temp objects
+	Py_CLEAR(newDataPoints);
+	Py_CLEAR(assetVal);
+	Py_CLEAR(readingId);
+	Py_CLEAR(readingTs);
+	Py_CLEAR(readingUserTs);
+
+	return readingObject;
+}
+
+/**
+ * Create a Python 3.5 object (list of dicts or list of
+ * reading records) to be passed to Python 3.5 loaded filter
  *
  * @param readings	The input readings
  * @return		PyObject pointer (list of dicts)
@@ -34,94 +274,247 @@ using namespace std;
  */
 PyObject* Python35Filter::createReadingsList(const vector<Reading *>& readings)
 {
-	// TODO add checks to all PyList_XYZ methods
-	PyObject* readingsList = PyList_New(0);
+	// Check reading record type is ready
+	if (m_readingRecord && !initReadingRecordType())
+	{
+		return NULL;
+	}
+
+	// List presized to the batch length
+	PyObject* readingsList = PyList_New(readings.size());
+	if (!readingsList)
+	{
+		return NULL;
+	}
 
 	// Iterate the input readings
-	for (vector<Reading *>::const_iterator elem = readings.begin();
-                                                      elem != readings.end();
-                                                      ++elem)
+	for (size_t i = 0; i < readings.size(); i++)
 	{
-		// Create an object (dict) with 'asset_code' and 'readings' key
-		PyObject* readingObject = PyDict_New();
+		PyObject* readingObject = this->createReadingObject(readings[i]);
+		if (!readingObject)
+		{
+			// Items not yet set are NULL
+			Py_DECREF(readingsList);
+			return NULL;
+		}
 
-		// Create object (dict) for reading Datapoints:
-		// this will be added as vale for key 'readings'
-		PyObject* newDataPoints = PyDict_New();
+		// Add new object to the list: reference is stolen
+		PyList_SET_ITEM(readingsList, i, readingObject);
+	}
 
-		// Get all datapoints
-		std::vector<Datapoint *>& dataPoints = (*elem)->getReadingData();
-		for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
-		{
-			PyObject* value;
-			DatapointValue::dataTagType dataType = (*it)->getData().getType();
+	// Return pointer of new allocated list
+	return readingsList;
+}
 
-			if (dataType == DatapointValue::dataTagType::T_INTEGER)
-			{
-				value = PyLong_FromLong((*it)->getData().toInt());
-			}
-			else if (dataType == DatapointValue::dataTagType::T_FLOAT)
+/**
+ * Create a Python 3.5 dict of asset code to list of readings
+ * (dicts or reading records) to be passed to Python 3.5 loaded filter
+ *
+ * Readings are grouped in a single pass, keeping their order
+ * within each asset.
+ *
+ * @param readings	The input readings
+ * @param groups	Set to the group index of each input reading,
+ *			in input order
+ * @param assets	Set to the asset code objects (new references)
+ *			by group index, released in case of errors
+ * @return		PyObject pointer (dict of lists)
+ *			or NULL in case of errors
+ */
+PyObject* Python35Filter::createReadingsGroups(const vector<Reading *>& readings,
+					       vector<size_t>& groups,
+					       vector<PyObject *>& assets)
+{
+	// Check reading record type is ready
+	if (m_readingRecord && !initReadingRecordType())
+	{
+		return NULL;
+	}
+
+	PyObject* readingsDict = PyDict_New();
+	if (!readingsDict)
+	{
+		return NULL;
+	}
+
+	vector<PyObject *> lists;
+	unordered_map<string, size_t> index;
+	groups.reserve(readings.size());
+
+	bool ok = true;
+	for (auto elem = readings.begin(); elem != readings.end() && ok; ++elem)
+	{
+		const string& assetName = (*elem)->getAssetName();
+		auto it = index.find(assetName);
+		size_t group;
+		if (it == index.end())
+		{
+			// New asset: add its list to the dict
+			PyObject* asset = nameToPython(assetName);
+			PyObject* list = asset ? PyList_New(0) : NULL;
+			ok = list && PyDict_SetItem(readingsDict, asset, list) == 0;
+			if (asset)
 			{
-				value = PyFloat_FromDouble((*it)->getData().toDouble());
+				assets.push_back(asset);
 			}
-			else
+			// Borrowed reference, owned by the dict
+			Py_XDECREF(list);
+			if (!ok)
 			{
-				value = PyBytes_FromString((*it)->getData().toString().c_str());
+				break;
 			}
+			group = lists.size();
+			index[assetName] = group;
+			lists.push_back(list);
+		}
+		else
+		{
+			group = it->second;
+		}
+		groups.push_back(group);
+
+		PyObject* readingObject = this->createReadingObject(*elem);
+		ok = readingObject && PyList_Append(lists[group], readingObject) == 0;
+		Py_XDECREF(readingObject);
+	}
 
-			// Add Datapoint: key and value
-			PyObject* key = PyBytes_FromString((*it)->getName().c_str());
-			PyDict_SetItem(newDataPoints,
-					key,
-					value);
-			
-			Py_CLEAR(key);
-			Py_CLEAR(value);
+	if (!ok)
+	{
+		Py_DECREF(readingsDict);
+		for (auto it = assets.begin(); it != assets.end(); ++it)
+		{
+			Py_DECREF(*it);
 		}
+		assets.clear();
+		groups.clear();
+		return NULL;
+	}
 
-		// Add reading datapoints
-		PyDict_SetItemString(readingObject, "reading", newDataPoints);
+	return readingsDict;
+}
 
-		// Add reading asset name
-		PyObject* assetVal = PyBytes_FromString((*elem)->getAssetName().c_str());
-		PyDict_SetItemString(readingObject, "asset_code", assetVal);
+/**
+ * Get the list of filtered readings from the dict of asset
+ * code to list of readings returned by the script
+ *
+ * The original interleaving of assets is restored: readings
+ * are taken from each asset list in the order of the input
+ * readings. Readings in excess and readings of new assets
+ * are appended after them.
+ *
+ * @param filteredData	The returned dict
+ * @param groups	The group index of each input reading
+ * @param assets	The asset code objects by group index
+ * @return		New reference to a list of readings
+ *			or NULL with a Python error set if returned
+ *			data is not a dict of lists
+ */
+PyObject* Python35Filter::ungroupReadings(PyObject* filteredData,
+					  const vector<size_t>& groups,
+					  const vector<PyObject *>& assets)
+{
+	if (!PyDict_Check(filteredData))
+	{
+		PyErr_Format(PyExc_TypeError,
+			     "filter method has returned '%s' instead of a dict",
+			     Py_TYPE(filteredData)->tp_name);
+		return NULL;
+	}
 
-		/**
-		 * Save id, timestamp and user_timestamp
-		 */
+	// Returned lists of input assets: borrowed references
+	vector<PyObject *> lists(assets.size(), (PyObject *)NULL);
+	vector<Py_ssize_t> next(assets.size(), 0);
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		PyObject* list = PyDict_GetItem(filteredData, assets[i]);
+		if (list && !PyList_Check(list))
+		{
+			PyErr_Format(PyExc_TypeError,
+				     "filter method has returned '%s' instead of "
+				     "a list for an asset",
+				     Py_TYPE(list)->tp_name);
+			return NULL;
+		}
+		lists[i] = list;
+	}
 
-		// Add reading id
-		PyObject* readingId = PyLong_FromUnsignedLong((*elem)->getId());
-		PyDict_SetItemString(readingObject, "id", readingId);
+	PyObject* readingsList = PyList_New(0);
+	if (!readingsList)
+	{
+		return NULL;
+	}
 
-		// Add reading timestamp
-		PyObject* readingTs = PyLong_FromUnsignedLong((*elem)->getTimestamp());
-		PyDict_SetItemString(readingObject, "ts", readingTs);
+	// Restore input interleaving
+	bool ok = true;
+	for (auto group = groups.begin(); group != groups.end() && ok; ++group)
+	{
+		PyObject* list = lists[*group];
+		if (list && next[*group] < PyList_GET_SIZE(list))
+		{
+			ok = PyList_Append(readingsList,
+					   PyList_GET_ITEM(list, next[*group]++)) == 0;
+		}
+	}
 
-		// Add reading user timestamp
-		PyObject* readingUserTs = PyLong_FromUnsignedLong((*elem)->getUserTimestamp());
-		PyDict_SetItemString(readingObject, "user_ts", readingUserTs);
+	// Readings in excess of input assets
+	for (size_t i = 0; i < lists.size() && ok; i++)
+	{
+		for (Py_ssize_t j = next[i]; ok && lists[i] && j < PyList_GET_SIZE(lists[i]); j++)
+		{
+			ok = PyList_Append(readingsList, PyList_GET_ITEM(lists[i], j)) == 0;
+		}
+	}
 
-		// Add new object to the list
-		PyList_Append(readingsList, readingObject);
+	// Readings of new assets: keys other than input asset codes
+	PyObject *key, *list;
+	Py_ssize_t pos = 0;
+	while (ok && PyDict_Next(filteredData, &pos, &key, &list))
+	{
+		int input = 0;
+		for (size_t i = 0; i < assets.size() && input == 0; i++)
+		{
+			input = PyObject_RichCompareBool(key, assets[i], Py_EQ);
+		}
+		if (input < 0)
+		{
+			ok = false;
+		}
+		else if (!input && PyList_Check(list))
+		{
+			for (Py_ssize_t j = 0; ok && j < PyList_GET_SIZE(list); j++)
+			{
+				ok = PyList_Append(readingsList, PyList_GET_ITEM(list, j)) == 0;
+			}
+		}
+	}
 
-		// Remove temp objects
-		Py_CLEAR(newDataPoints);
-		Py_CLEAR(assetVal);
-		Py_CLEAR(readingId);
-		Py_CLEAR(readingTs);
-		Py_CLEAR(readingUserTs);
-		Py_CLEAR(readingObject);
+	if (!ok)
+	{
+		Py_CLEAR(readingsList);
 	}
 
-	// Return pointer of new allocated list
 	return readingsList;
 }
 
+/**
+ * Delete a vector of readings and the readings it holds
+ *
+ * @param readings	The vector to delete
+ */
+static void deleteReadings(vector<Reading *>* readings)
+{
+	for (auto it = readings->begin(); it != readings->end(); ++it)
+	{
+		delete *it;
+	}
+	delete readings;
+}
+
 /**
  * Get the vector of filtered readings from Python 3.5 script
  *
- * @param filteredData	Python 3.5 Object (list of dicts)
+ * @param filteredData	Python 3.5 Object (list of dicts
+ *			and/or reading records)
  * @return		Pointer to a new allocated vector<Reading *>
  *			or NULL in case of errors
  * Note:
@@ -131,155 +524,743 @@ PyObject* Python35Filter::createReadingsList(const vector<Reading *>& readings)
  */
 vector<Reading *>* Python35Filter::getFilteredReadings(PyObject* filteredData)
 {
-	// Create result set
+	if (!PyList_Check(filteredData))
+	{
+		Logger::getLogger()->error("Filter '%s', script '%s': "
+					   "filter method has not returned a list",
+					   this->getName().c_str(),
+					   m_pythonScript.c_str());
+		return NULL;
+	}
+
+	// Create result set, sized for all list elements
+	Py_ssize_t size = PyList_GET_SIZE(filteredData);
 	vector<Reading *>* newReadings = new vector<Reading *>();
+	newReadings->reserve(size);
+
+	// With a declared output schema malformed readings
+	// are rejected one by one, without failing the batch
+	bool schema = m_outputSchema.isActive();
+	unsigned long rejected = 0;
+	unsigned long repaired = 0;
 
 	// Iterate filtered data in the list
-	for (int i = 0; i < PyList_Size(filteredData); i++)
+	for (Py_ssize_t i = 0; i < size; i++)
 	{
 		// Get list item: borrowed reference.
-		PyObject* element = PyList_GetItem(filteredData, i);
-		if (!element)
-		{
-			// Failure
-			if (PyErr_Occurred())
-			{
-				this->logErrorMessage();
-			}
-			delete newReadings;
+		PyObject* element = PyList_GET_ITEM(filteredData, i);
 
-			return NULL;
+		// Get reading values: borrowed references.
+		PyObject *assetCode, *reading, *id, *ts, *uts;
+		if (readingRecordType &&
+		    PyObject_TypeCheck(element, readingRecordType))
+		{
+			// Reading record: get values by offset
+			assetCode = PyStructSequence_GET_ITEM(element, READING_RECORD_ASSET_CODE);
+			reading = PyStructSequence_GET_ITEM(element, READING_RECORD_READING);
+			id = PyStructSequence_GET_ITEM(element, READING_RECORD_ID);
+			ts = PyStructSequence_GET_ITEM(element, READING_RECORD_TS);
+			uts = PyStructSequence_GET_ITEM(element, READING_RECORD_USER_TS);
+		}
+		else if (PyDict_Check(element))
+		{
+			assetCode = PyDict_GetItemString(element, "asset_code");
+			reading = PyDict_GetItemString(element, "reading");
+			id = PyDict_GetItemString(element, "id");
+			ts = PyDict_GetItemString(element, "ts");
+			uts = PyDict_GetItemString(element, "user_ts");
+		}
+		else
+		{
+			assetCode = reading = id = ts = uts = NULL;
 		}
 
-		// Get 'asset_code' value: borrowed reference.
-		PyObject* assetCode = PyDict_GetItemString(element,
-							   "asset_code");
-		// Get 'reading' value: borrowed reference.
-		PyObject* reading = PyDict_GetItemString(element,
-							 "reading");
 		// Keys not found or reading is not a dict
+		string assetName;
 		if (!assetCode ||
 		    !reading ||
-		    !PyDict_Check(reading))
+		    !PyDict_Check(reading) ||
+		    !nameFromPython(assetCode, assetName))
 		{
+			if (schema)
+			{
+				PyErr_Clear();
+				rejected++;
+				continue;
+			}
+
 			// Failure
 			if (PyErr_Occurred())
 			{
 				this->logErrorMessage();
 			}
-			delete newReadings;
+			deleteReadings(newReadings);
 
 			return NULL;
 		}
 
-		// Fetch all Datapoins in 'reading' dict			
-		PyObject *dKey, *dValue;
-		Py_ssize_t dPos = 0;
 		Reading* newReading = NULL;
 
-		// Fetch all Datapoins in 'reading' dict
-		// dKey and dValue are borrowed references
-		while (PyDict_Next(reading, &dPos, &dKey, &dValue))
+		// Datapoints declared in output schema for this asset
+		const vector<OutputSchema::Field>* fields = NULL;
+		if (schema)
 		{
-			DatapointValue* dataPoint;
-			if (PyLong_Check(dValue) || PyLong_Check(dValue))
-			{
-				dataPoint = new DatapointValue((long)PyLong_AsUnsignedLongMask(dValue));
-			}
-			else if (PyFloat_Check(dValue))
+			fields = m_outputSchema.getFields(assetName);
+		}
+
+		if (fields)
+		{
+			if (!m_outputSchema.decode(assetName,
+						   *fields,
+						   reading,
+						   &newReading,
+						   repaired))
 			{
-				dataPoint = new DatapointValue(PyFloat_AS_DOUBLE(dValue));
+				rejected++;
+				continue;
 			}
-			else if (PyBytes_Check(dValue))
+		}
+		else
+		{
+			vector<Datapoint *> values;
+			values.reserve(PyDict_Size(reading));
+			bool unsupported = false;
+
+			// Fetch all Datapoins in 'reading' dict
+			// dKey and dValue are borrowed references
+			PyObject *dKey, *dValue;
+			Py_ssize_t dPos = 0;
+			while (PyDict_Next(reading, &dPos, &dKey, &dValue))
 			{
-				dataPoint = new DatapointValue(string(PyBytes_AsString(dValue)));
+				string name;
+				DatapointValue* dataPoint = nameFromPython(dKey, name) ?
+							    datapointFromPython(dValue) :
+							    NULL;
+				if (!dataPoint)
+				{
+					// Unsupported key or value type
+					unsupported = true;
+					break;
+				}
+
+				values.push_back(new Datapoint(name, *dataPoint));
+
+				// Remove temp objects
+				delete dataPoint;
 			}
-			else
+
+			if (unsupported)
 			{
-				delete newReadings;
-				delete dataPoint;
+				PyErr_Clear();
+				for (auto it = values.begin(); it != values.end(); ++it)
+				{
+					delete *it;
+				}
+				if (schema)
+				{
+					rejected++;
+					continue;
+				}
+				deleteReadings(newReadings);
 
 				return NULL;
 			}
 
-			// Add / Update the new Reading data			
-			if (newReading == NULL)
-			{
-				newReading = new Reading(string(PyBytes_AsString(assetCode)),
-							 new Datapoint(string(PyBytes_AsString(dKey)),
-								       *dataPoint));
-			}
-			else
+			if (!values.empty())
 			{
-				newReading->addDatapoint(new Datapoint(string(PyBytes_AsString(dKey)),
-								       *dataPoint));
+				newReading = new Reading(assetName, values);
 			}
+		}
 
+		if (newReading)
+		{
 			/**
 			 * Set id, uuid, ts and user_ts of the original data
 			 */
-
-			// Get 'id' value: borrowed reference.
-			PyObject* id = PyDict_GetItemString(element, "id");
 			if (id && PyLong_Check(id))
 			{
 				// Set id
 				newReading->setId(PyLong_AsUnsignedLong(id));
 			}
-
-			// Get 'ts' value: borrowed reference.
-			PyObject* ts = PyDict_GetItemString(element, "ts");
 			if (ts && PyLong_Check(ts))
 			{
 				// Set timestamp
 				newReading->setTimestamp(PyLong_AsUnsignedLong(ts));
 			}
-
-			// Get 'user_ts' value: borrowed reference.
-			PyObject* uts = PyDict_GetItemString(element, "user_ts");
 			if (uts && PyLong_Check(uts))
 			{
 				// Set user timestamp
 				newReading->setUserTimestamp(PyLong_AsUnsignedLong(uts));
 			}
 
-			// Remove temp objects
-			delete dataPoint;
-		}
-
-		if (newReading)
-		{
 			// Add the new reading to result vector
 			newReadings->push_back(newReading);
 		}
 	}
 
+	if (rejected || repaired)
+	{
+		m_outputSchema.addResults(rejected, repaired);
+		m_stats.addSchemaResults(rejected, repaired);
+		Logger::getLogger()->debug("Filter '%s', script '%s': output schema "
+					   "rejected %lu readings, repaired %lu values",
+					   this->getName().c_str(),
+					   m_pythonScript.c_str(),
+					   rejected,
+					   repaired);
+	}
+
 	return newReadings;
 }
 
 /**
- * Log current Python 3.5 error message
+ * Pass readings to the Python 3.5 script and get the filtered ones
+ *
+ * If a target GIL hold time is set, readings are passed to the script
+ * in slices sized from the measured per reading cost, releasing the GIL
+ * between slices. Slices are also limited by the available memory budget
+ * of Python conversions. Results of all slices are merged.
+ *
+ * @param readings	The input readings
+ * @param overloaded	The overload state of the batch
+ * @param deadline	The batch deadline, wall clock seconds, 0 if none
+ * @return		Pointer to a new allocated vector<Reading *>
+ *			or NULL in case of errors in any slice
  */
-void Python35Filter::logErrorMessage()
+vector<Reading *>* Python35Filter::filterReadings(const vector<Reading *>& readings,
+						  bool overloaded,
+						  double deadline)
 {
-#ifdef PYTHON_CONSOLE_DEBUG
-	// Print full Python stacktrace 
-	PyErr_Print();
-#endif
-	//Get error message
-	PyObject *pType, *pValue, *pTraceback;
-	PyErr_Fetch(&pType, &pValue, &pTraceback);
-	PyErr_NormalizeException(&pType, &pValue, &pTraceback);
-
-	PyObject* str_exc_value = PyObject_Repr(pValue);
-	PyObject* pyExcValueStr = PyUnicode_AsEncodedString(str_exc_value, "utf-8", "Error ~");
+	unsigned long gilHoldTime;
+	bool budget;
+	bool pureValue;
+	{
+		lock_guard<mutex> guard(m_configMutex);
+		gilHoldTime = m_gilHoldTime;
+		budget = m_conversionBudget.isActive();
+		pureValue = m_valueCache.isActive();
+	}
+
+	if (pureValue)
+	{
+		// Pure per datapoint mode: no readings list conversion
+		return this->mapValues(readings);
+	}
+
+	vector<Reading *>* newReadings = NULL;
+	vector<Reading *> slice;
+	size_t start = 0;
+	// Pieces cut by the memory budget
+	unsigned long budgetPieces = 0;
+
+	do
+	{
+		// Slice size from target hold time and per reading cost
+		size_t sliceSize = readings.size() - start;
+		if (gilHoldTime)
+		{
+			size_t maxSize = m_readingCost > 0.0 ?
+					 (size_t)(gilHoldTime * 1000.0 / m_readingCost) :
+					 FIRST_SLICE_SIZE;
+			if (maxSize < MIN_SLICE_SIZE)
+			{
+				maxSize = MIN_SLICE_SIZE;
+			}
+			if (maxSize < sliceSize)
+			{
+				sliceSize = maxSize;
+			}
+		}
+
+		// Slice size from available memory budget
+		unsigned long budgetBytes = 0;
+		if (budget)
+		{
+			size_t fitSize = m_conversionBudget.reserve(readings,
+								    start,
+								    sliceSize,
+								    budgetBytes);
+			if (fitSize == 0)
+			{
+				// Budget used by other filters:
+				// pass the rest onwards unfiltered
+				Logger::getLogger()->warn("Filter '%s', %lu readings over memory "
+							  "budget passed through unfiltered",
+							  this->getName().c_str(),
+							  (unsigned long)(readings.size() - start));
+				if (!newReadings)
+				{
+					newReadings = new vector<Reading *>();
+				}
+				for (size_t i = start; i < readings.size(); i++)
+				{
+					newReadings->push_back(new Reading(*readings[i]));
+				}
+				break;
+			}
+			if (fitSize < sliceSize)
+			{
+				sliceSize = fitSize;
+				budgetPieces++;
+			}
+			else if (budgetPieces)
+			{
+				// Last piece
+				budgetPieces++;
+			}
+		}
+
+		const vector<Reading *>* input = &readings;
+		if (sliceSize < readings.size())
+		{
+			slice.assign(readings.begin() + start,
+				     readings.begin() + start + sliceSize);
+			input = &slice;
+		}
+
+		auto tWait = chrono::steady_clock::now();
+		PyGILState_STATE state = PyGILState_Ensure();
+		auto tStart = chrono::steady_clock::now();
+		m_stats.addGilWait(chrono::duration_cast<chrono::microseconds>(tStart - tWait).count());
+		m_stats.addBytes(budget ?
+				 budgetBytes :
+				 ConversionBudget::estimate(*input, 0, input->size()));
+		m_memoryAccounting.beforeBatch();
+		bool gcCounted = m_gcPolicy.beforeCall();
+		vector<Reading *>* filtered = this->callScript(*input,
+							       m_filterCall,
+							       overloaded,
+							       deadline);
+		auto tEnd = chrono::steady_clock::now();
+		m_gcPolicy.afterCall(gcCounted);
+		m_memoryAccounting.afterBatch(this->getName());
+		PyGILState_Release(state);
+
+		// Python objects of input readings have been released
+		if (budget)
+		{
+			m_conversionBudget.release(budgetBytes);
+		}
+
+		// Update per reading cost, in microseconds
+		if (sliceSize)
+		{
+			double elapsed = chrono::duration<double, micro>(tEnd - tStart).count();
+			double cost = elapsed / sliceSize;
+			m_readingCost = m_readingCost > 0.0 ?
+					0.7 * m_readingCost + 0.3 * cost :
+					cost;
+		}
+
+		if (!filtered)
+		{
+			// Remove results of previous slices
+			if (newReadings)
+			{
+				deleteReadings(newReadings);
+			}
+			return NULL;
+		}
+
+		// Merge slice results
+		if (!newReadings)
+		{
+			newReadings = filtered;
+		}
+		else
+		{
+			newReadings->insert(newReadings->end(),
+					    filtered->begin(),
+					    filtered->end());
+			delete filtered;
+		}
+
+		start += sliceSize;
+		if (start < readings.size())
+		{
+			// Let other threads take the GIL
+			this_thread::yield();
+		}
+	} while (start < readings.size());
+
+	if (budgetPieces)
+	{
+		m_conversionBudget.countSplit(budgetPieces);
+	}
+
+	return newReadings;
+}
+
+/**
+ * Call the Python 3.5 script filter method
+ *
+ * This method must be called holding the GIL
+ *
+ * @param readings	The input readings
+ * @param call		The script method to call
+ * @param overloaded	The overload state, passed in context
+ * @param deadline	The deadline, wall clock seconds, 0 if none
+ * @return		Pointer to a new allocated vector<Reading *>
+ *			or NULL in case of errors
+ */
+vector<Reading *>* Python35Filter::callScript(const vector<Reading *>& readings,
+					      ScriptCall& call,
+					      bool overloaded,
+					      double deadline)
+{
+	// Check filter method: it might have been removed by reconfiguration
+	if (!call.isSet())
+	{
+		return NULL;
+	}
+
+	// Bind foglamp_filter module calls to this filter
+	FilterScope scope(this);
+
+	// - 1 - Create Python list of dicts as input to the filter,
+	// or dict of asset code to list of dicts
+	bool grouped = m_groupByAsset;
+	vector<size_t> groups;
+	vector<PyObject *> assets;
+	PyObject* readingsList = grouped ?
+				 this->createReadingsGroups(readings, groups, assets) :
+				 this->createReadingsList(readings);
+
+	// Check for errors
+	if (!readingsList)
+	{
+		// Errors while creating Python 3.5 filter input object
+		Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
+					   "create filter data error, action: %s",
+					   this->getName().c_str(),
+					   this->getCategoryName().c_str(),
+					   m_pythonScript.c_str(),
+					  "pass unfiltered data onwards");
+		return NULL;
+	}
+
+	// Optional batch context and deadline, if the method accepts them
+	PyObject* pContext = NULL;
+	PyObject* pDeadline = NULL;
+	if (call.getExtraArgs() > 0)
+	{
+		pContext = PyDict_New();
+		PyObject* value = PyUnicode_FromString(this->getName().c_str());
+		PyDict_SetItemString(pContext, "filter", value);
+		Py_CLEAR(value);
+		value = PyLong_FromSize_t(readings.size());
+		PyDict_SetItemString(pContext, "readings", value);
+		Py_CLEAR(value);
+		PyDict_SetItemString(pContext, "grouped", grouped ? Py_True : Py_False);
+		PyDict_SetItemString(pContext, "overloaded", overloaded ? Py_True : Py_False);
+	}
+	if (call.getExtraArgs() > 1 && deadline > 0.0)
+	{
+		pDeadline = PyFloat_FromDouble(deadline);
+	}
+
+	// - 2 - Call Python method passing an object
+	m_profiler.enterCall();
+	PyObject* pReturn = call.call(readingsList, pContext, pDeadline);
+	m_profiler.leaveCall();
+
+	Py_CLEAR(pContext);
+	Py_CLEAR(pDeadline);
+
+	// Free filter input data
+	Py_CLEAR(readingsList);
+
+	if (grouped && pReturn)
+	{
+		// Restore input order from dict of asset code to list
+		PyObject* pList = this->ungroupReadings(pReturn, groups, assets);
+		Py_CLEAR(pReturn);
+		pReturn = pList;
+	}
+	for (auto it = assets.begin(); it != assets.end(); ++it)
+	{
+		Py_DECREF(*it);
+	}
+
+	// - 3 - Handle filter returned data
+	if (!pReturn)
+	{
+		// Errors while getting result object
+		Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
+					   "filter error, action: %s",
+					   this->getName().c_str(),
+					   this->getCategoryName().c_str(),
+					   m_pythonScript.c_str(),
+					   "pass unfiltered data onwards");
+
+		// Errors while getting result object
+		this->logErrorMessage();
+
+		this->recycleContainers();
+
+		return NULL;
+	}
+
+	// Get new set of readings from Python filter
+	vector<Reading *>* newReadings = this->getFilteredReadings(pReturn);
+
+	// Remove pReturn object
+	Py_CLEAR(pReturn);
+
+	this->recycleContainers();
+
+	return newReadings;
+}
+
+/**
+ * Recycle input dicts not retained by the script
+ *
+ * This method must be called holding the GIL
+ */
+void Python35Filter::recycleContainers()
+{
+	// Reading dicts hold datapoint dicts: recycle them first
+	m_readingPool.recycle();
+	m_datapointsPool.recycle();
+}
+
+/**
+ * Release Python objects held by the filter
+ * before the interpreter is finalised
+ *
+ * This method must be called holding the GIL
+ */
+void Python35Filter::releasePythonObjects()
+{
+	m_outputSchema.clear();
+	for (int i = 0; i < READING_RECORD_FIELDS; i++)
+	{
+		Py_CLEAR(m_readingKeys[i]);
+	}
+	m_readingPool.clear();
+	m_datapointsPool.clear();
+}
+
+/**
+ * Pure per datapoint mode: map each datapoint value through
+ * the script 'filter_value(asset, datapoint, value)' method.
+ *
+ * Results are cached by (asset, datapoint, value): the GIL is taken
+ * only at the first cache miss and the method is called only on misses.
+ * Values other than integer, float and string are not changed.
+ *
+ * @param readings	The input readings
+ * @return		Pointer to a new allocated vector<Reading *>
+ *			or NULL in case of errors
+ */
+vector<Reading *>* Python35Filter::mapValues(const vector<Reading *>& readings)
+{
+	vector<Reading *>* newReadings = new vector<Reading *>();
+	newReadings->reserve(readings.size());
+
+	bool gil = false;
+	PyGILState_STATE state;
+
+	for (auto elem = readings.begin(); elem != readings.end(); ++elem)
+	{
+		const string& asset = (*elem)->getAssetName();
+		vector<Datapoint *>& dataPoints = (*elem)->getReadingData();
+		vector<Datapoint *> values;
+		values.reserve(dataPoints.size());
+
+		for (auto it = dataPoints.begin(); it != dataPoints.end(); ++it)
+		{
+			DatapointValue& data = (*it)->getData();
+			DatapointValue::dataTagType dataType = data.getType();
+			DatapointValue* result = NULL;
+
+			if (dataType == DatapointValue::dataTagType::T_INTEGER ||
+			    dataType == DatapointValue::dataTagType::T_FLOAT ||
+			    dataType == DatapointValue::dataTagType::T_STRING)
+			{
+				string key = ValueCache::makeKey(asset, (*it)->getName(), data);
+				if (!m_valueCache.get(key, &result))
+				{
+					if (!gil)
+					{
+						state = PyGILState_Ensure();
+						gil = true;
+					}
+					result = this->callValueMethod(asset, (*it)->getName(), data);
+					if (result)
+					{
+						m_valueCache.put(key, *result);
+					}
+				}
+			}
+			else
+			{
+				result = new DatapointValue(data);
+			}
+
+			if (!result)
+			{
+				// Script error
+				for (auto v = values.begin(); v != values.end(); ++v)
+				{
+					delete *v;
+				}
+				deleteReadings(newReadings);
+				if (gil)
+				{
+					// No exception is left to the caller
+					PyErr_Clear();
+					PyGILState_Release(state);
+				}
+
+				return NULL;
+			}
+
+			values.push_back(new Datapoint((*it)->getName(), *result));
+			delete result;
+		}
+
+		// Set id, ts and user_ts of the original data
+		Reading* newReading = new Reading(asset, values);
+		struct timeval tm;
+		newReading->setId((*elem)->getId());
+		(*elem)->getTimestamp(&tm);
+		newReading->setTimestamp(tm);
+		(*elem)->getUserTimestamp(&tm);
+		newReading->setUserTimestamp(tm);
+
+		newReadings->push_back(newReading);
+	}
+
+	if (gil)
+	{
+		PyGILState_Release(state);
+	}
+
+	return newReadings;
+}
+
+/**
+ * Call the script pure per datapoint method
+ *
+ * This method must be called holding the GIL
+ *
+ * @param asset		The asset name
+ * @param datapoint	The datapoint name
+ * @param value		The input value
+ * @return		New allocated result value, a copy of input
+ *			value if method returns None,
+ *			NULL in case of errors
+ */
+DatapointValue* Python35Filter::callValueMethod(const string& asset,
+						const string& datapoint,
+						const DatapointValue& value)
+{
+	// Check method: it might have been removed by reconfiguration
+	if (!m_pValueFunc)
+	{
+		return NULL;
+	}
+
+	// Bind foglamp_filter module calls to this filter
+	FilterScope scope(this);
+
+	PyObject* pValue;
+	DatapointValue::dataTagType dataType = value.getType();
+	if (dataType == DatapointValue::dataTagType::T_INTEGER)
+	{
+		pValue = PyLong_FromLong(value.toInt());
+	}
+	else if (dataType == DatapointValue::dataTagType::T_FLOAT)
+	{
+		pValue = PyFloat_FromDouble(value.toDouble());
+	}
+	else
+	{
+		string text = value.toStringValue();
+		pValue = PyUnicode_FromStringAndSize(text.data(), text.length());
+	}
+	if (!pValue)
+	{
+		PyErr_Clear();
+		return NULL;
+	}
+
+	m_profiler.enterCall();
+	PyObject* pReturn = PyObject_CallFunction(m_pValueFunc,
+						  (char *)string("ssO").c_str(),
+						  asset.c_str(),
+						  datapoint.c_str(),
+						  pValue);
+	m_profiler.leaveCall();
+
+	Py_CLEAR(pValue);
+
+	DatapointValue* result = NULL;
+	if (!pReturn)
+	{
+		this->logErrorMessage();
+	}
+	else if (pReturn == Py_None)
+	{
+		result = new DatapointValue(value);
+	}
+	else
+	{
+		result = datapointFromPython(pReturn);
+	}
+
+	// Conversion errors, i.e. integer overflow, leave an exception
+	if (result && PyErr_Occurred())
+	{
+		delete result;
+		result = NULL;
+	}
+
+	if (!result)
+	{
+		PyErr_Clear();
+		Logger::getLogger()->error("Filter '%s', script '%s', method '%s' "
+					   "error for asset '%s', datapoint '%s', "
+					   "action: %s",
+					   this->getName().c_str(),
+					   m_pythonScript.c_str(),
+					   DEFAULT_FILTER_VALUE_METHOD,
+					   asset.c_str(),
+					   datapoint.c_str(),
+					   "pass unfiltered data onwards");
+	}
+
+	Py_CLEAR(pReturn);
+
+	return result;
+}
+
+/**
+ * Log current Python 3.5 error message
+ */
+void Python35Filter::logErrorMessage()
+{
+#ifdef PYTHON_CONSOLE_DEBUG
+	// Print full Python stacktrace 
+	PyErr_Print();
+#endif
+	//Get error message
+	PyObject *pType, *pValue, *pTraceback;
+	PyErr_Fetch(&pType, &pValue, &pTraceback);
+	PyErr_NormalizeException(&pType, &pValue, &pTraceback);
 
 	// NOTE from :
 	// https://docs.python.org/2/c-api/exceptions.html
 	//
 	// The value and traceback object may be NULL
 	// even when the type object is not.	
-	const char* pErrorMessage = pValue ?
+	PyObject* str_exc_value = pValue ? PyObject_Repr(pValue) : NULL;
+	PyObject* pyExcValueStr = str_exc_value ?
+				  PyUnicode_AsEncodedString(str_exc_value, "utf-8", "Error ~") :
+				  NULL;
+
+	const char* pErrorMessage = pyExcValueStr ?
 				    PyBytes_AsString(pyExcValueStr) :
 				    "no error description.";
 
@@ -321,6 +1302,9 @@ bool Python35Filter::reconfigure(const string& newConfig)
 
 	PyGILState_STATE state = PyGILState_Ensure(); // acquire GIL
 
+	// Bind foglamp_filter module calls to this filter
+	FilterScope scope(this);
+
 	// Get Python script file from "file" attibute of "scipt" item
 	if (category.itemExists(SCRIPT_CONFIG_ITEM_NAME))
 	{
@@ -368,18 +1352,34 @@ bool Python35Filter::reconfigure(const string& newConfig)
 		return false;
 	}
 
+	string source;
+	uint64_t hash;
+
 	// Reload module or Import module ?
-	if (newScript.compare(m_pythonScript) == 0)
+	if (newScript.compare(m_pythonScript) == 0 &&
+	    m_pModule &&
+	    m_scriptHash &&
+	    ScriptCache::readScript(this->getScriptFile(), source, hash) &&
+	    hash == m_scriptHash)
+	{
+		// Script content has not changed: keep loaded module
+		// and its resolved methods, configure() only calls
+		// set_filter_config
+		Logger::getLogger()->debug("Filter '%s', script '%s' unchanged, "
+					   "module not reloaded",
+					   this->getName().c_str(),
+					   m_pythonScript.c_str());
+	}
+	else if (newScript.compare(m_pythonScript) == 0 && m_pModule)
 	{
 		// Reimport module
-		PyObject* newModule = PyImport_ReloadModule(m_pModule);
+		PyObject* newModule = this->loadScript(true);
 		if (newModule)
 		{
 			// Cleanup Loaded module
 			Py_CLEAR(m_pModule);
 			m_pModule = NULL;
-			Py_CLEAR(m_pFunc);
-			m_pFunc = NULL;
+			m_filterCall.clear();
 
 			// Set new name
 			m_pythonScript = newScript;
@@ -408,14 +1408,13 @@ bool Python35Filter::reconfigure(const string& newConfig)
 		// Cleanup Loaded module
 		Py_CLEAR(m_pModule);
 		m_pModule = NULL;
-		Py_CLEAR(m_pFunc);
-		m_pFunc = NULL;
+		m_filterCall.clear();
 
 		// Set new name
 		m_pythonScript = newScript;
 
 		// Import the new module
-		PyObject* newModule = PyImport_ImportModule(m_pythonScript.c_str());
+		PyObject* newModule = this->loadScript(false);
 
 		// Set reloaded module
 		m_pModule = newModule;
@@ -428,6 +1427,12 @@ bool Python35Filter::reconfigure(const string& newConfig)
 				category.getValue("enable").compare("True") == 0;
 	}
 
+	// Set native processing options
+	this->setOptions(category);
+
+	// Update filter configuration, read by configure()
+	this->setConfig(newConfig);
+
 	bool ret = this->configure();
 
 	PyGILState_Release(state);
@@ -456,6 +1461,9 @@ bool Python35Filter::configure()
 
 	Logger::getLogger()->debug("%s:%d: m_pythonScript=%s", __FUNCTION__, __LINE__, m_pythonScript.c_str());
 
+	// Bind foglamp_filter module calls to this filter
+	FilterScope scope(this);
+
 	// 1) Get methodName
 	found = m_pythonScript.rfind(PYTHON_SCRIPT_METHOD_PREFIX);
 	if (found != std::string::npos)
@@ -490,7 +1498,12 @@ bool Python35Filter::configure()
 		this->disableFilter();
 
 		m_pModule = NULL;
-		m_pFunc = NULL;
+		m_filterCall.clear();
+		m_configCall.clear();
+		Py_CLEAR(m_pValueFunc);
+		m_priorityCall.clear();
+		m_timerCall.clear();
+		m_outputSchema.clear();
 
 		return true;
 	}
@@ -498,7 +1511,7 @@ bool Python35Filter::configure()
 	// 2) Import Python script if module object is not set
 	if (!m_pModule)
 	{
-		m_pModule = PyImport_ImportModule(m_pythonScript.c_str());
+		m_pModule = this->loadScript(false);
 	}
 
 	// Check whether the Python module has been imported
@@ -519,10 +1532,25 @@ bool Python35Filter::configure()
 		return false;
 	}
 
-	// Fetch filter method in loaded object
-	m_pFunc = PyObject_GetAttrString(m_pModule, filterMethod.c_str());
-
-	if (!PyCallable_Check(m_pFunc))
+	// Fetch filter method in loaded object, once per module version:
+	// it is optional in pure per datapoint mode
+	bool valueMode = m_valueCache.isActive();
+	if (!m_filterCall.resolve(m_pModule,
+				  m_moduleVersion,
+				  filterMethod.c_str(),
+				  true) &&
+	    valueMode)
+	{
+		PyErr_Clear();
+		Logger::getLogger()->debug("Filter '%s', script '%s': method '%s' "
+					   "not found, only '%s' is called in "
+					   "pure per datapoint mode",
+					   this->getName().c_str(),
+					   m_pythonScript.c_str(),
+					   filterMethod.c_str(),
+					   DEFAULT_FILTER_VALUE_METHOD);
+	}
+	else if (!m_filterCall.isSet())
 	{
 		// Failure
 		if (PyErr_Occurred())
@@ -537,8 +1565,7 @@ bool Python35Filter::configure()
 					   m_pythonScript.c_str());
 		Py_CLEAR(m_pModule);
 		m_pModule = NULL;
-		Py_CLEAR(m_pFunc);
-		m_pFunc = NULL;
+		m_filterCall.clear();
 
 		// This will abort the filter pipeline set up
 		return false;
@@ -561,10 +1588,11 @@ bool Python35Filter::configure()
 	/**
 	 * We now pass the filter JSON configuration to the loaded module
 	 */
-	PyObject* pConfigFunc = PyObject_GetAttrString(m_pModule,
-							   (char *)string(DEFAULT_FILTER_CONFIG_METHOD).c_str());
 	// Check whether "set_filter_config" method exists
-	if (PyCallable_Check(pConfigFunc))
+	if (m_configCall.resolve(m_pModule,
+				 m_moduleVersion,
+				 DEFAULT_FILTER_CONFIG_METHOD,
+				 false))
 	{
 		// Set configuration object 
 		PyObject* pConfig = PyDict_New();
@@ -581,12 +1609,7 @@ bool Python35Filter::configure()
 		 *
 		 * set_filter_config(config) returns 'True'
 		 */
-		//PyObject* pSetConfig = PyObject_CallMethod(pModule,
-		PyObject* pSetConfig = PyObject_CallFunctionObjArgs(pConfigFunc,
-									// arg 1
-									pConfig,
-									// end of args
-									NULL);
+		PyObject* pSetConfig = m_configCall.call(pConfig);
 
 		// Check result
 		if (!pSetConfig ||
@@ -597,15 +1620,12 @@ bool Python35Filter::configure()
 
 			Py_CLEAR(m_pModule);
 			m_pModule = NULL;
-			Py_CLEAR(m_pFunc);
-			m_pFunc = NULL;
+			m_filterCall.clear();
+			m_configCall.clear();
 			// Remove temp objects
 			Py_CLEAR(pConfig);
 			Py_CLEAR(pSetConfig);
 
-			// Remove function object
-			Py_CLEAR(pConfigFunc);
-
 			return false;
 		}
 		// Remove call object
@@ -619,15 +1639,152 @@ bool Python35Filter::configure()
 		PyErr_Clear();
 	}
 
-	// Remove function object
-	Py_CLEAR(pConfigFunc);
+	// Pure per datapoint mode: cached results of previous
+	// configuration or module are no longer valid
+	m_valueCache.clear();
+	Py_CLEAR(m_pValueFunc);
+	if (valueMode)
+	{
+		m_pValueFunc = PyObject_GetAttrString(m_pModule,
+						      DEFAULT_FILTER_VALUE_METHOD);
+		if (!m_pValueFunc || !PyCallable_Check(m_pValueFunc))
+		{
+			PyErr_Clear();
+			Py_CLEAR(m_pValueFunc);
+			Logger::getLogger()->error("Filter '%s', script '%s': method '%s' "
+						   "not found, pure per datapoint mode "
+						   "will pass unfiltered data onwards",
+						   this->getName().c_str(),
+						   m_pythonScript.c_str(),
+						   DEFAULT_FILTER_VALUE_METHOD);
+		}
+	}
 
-	return true;
-}
+	// Script method for priority readings
+	if (!m_priorityScript)
+	{
+		m_priorityCall.clear();
+	}
+	else
+	{
+		if (!m_priorityCall.resolve(m_pModule,
+					    m_moduleVersion,
+					    DEFAULT_FILTER_PRIORITY_METHOD,
+					    true))
+		{
+			PyErr_Clear();
+			Logger::getLogger()->error("Filter '%s', script '%s': method '%s' "
+						   "not found, priority readings "
+						   "will be passed unfiltered",
+						   this->getName().c_str(),
+						   m_pythonScript.c_str(),
+						   DEFAULT_FILTER_PRIORITY_METHOD);
+		}
+	}
 
-/**
- * Set the Python script name to load.
- *
+	// Compile optional output schema declared by the script
+	m_outputSchema.clear();
+	PyObject* pSchema = PyObject_GetAttrString(m_pModule,
+						   DEFAULT_FILTER_SCHEMA_VARIABLE);
+	if (pSchema && pSchema != Py_None)
+	{
+		// Datapoint keys as created by createReadingsList
+		if (!m_outputSchema.compile(pSchema, nameToPython))
+		{
+			PyErr_Clear();
+			Logger::getLogger()->error("Filter '%s', script '%s': "
+						   "invalid '%s' declaration, "
+						   "output schema not used",
+						   this->getName().c_str(),
+						   m_pythonScript.c_str(),
+						   DEFAULT_FILTER_SCHEMA_VARIABLE);
+		}
+	}
+	else
+	{
+		PyErr_Clear();
+	}
+	Py_CLEAR(pSchema);
+
+	return true;
+}
+
+/**
+ * Get the full path of the script file
+ *
+ * @return	The script file in filters path
+ */
+string Python35Filter::getScriptFile() const
+{
+	return m_filtersPath + "/" + m_pythonScript + PYTHON_SCRIPT_FILENAME_EXTENSION;
+}
+
+/**
+ * Import or reload the script module
+ *
+ * The script is compiled through the compiled script cache:
+ * scripts with the same content are compiled only once.
+ * If the script file cannot be read the standard import
+ * machinery is used.
+ *
+ * This method must be called holding the GIL
+ *
+ * @param reload	True to execute the script again in loaded module
+ * @return		New reference to the module or NULL on errors
+ */
+PyObject* Python35Filter::loadScript(bool reload)
+{
+	string fileName = this->getScriptFile();
+	string source;
+	uint64_t hash;
+
+	// Methods of previous load are resolved again
+	m_moduleVersion++;
+
+	m_scriptHash = 0;
+	if (!ScriptCache::readScript(fileName, source, hash))
+	{
+		// Executed code is unknown
+		scriptCache.setLoaded(m_pythonScript, 0);
+		return reload ?
+		       PyImport_ReloadModule(m_pModule) :
+		       PyImport_ImportModule(m_pythonScript.c_str());
+	}
+
+	// Module already imported by another filter instance
+	// with the same code: share it
+	if (!reload &&
+	    PyDict_GetItemString(PyImport_GetModuleDict(), m_pythonScript.c_str()) &&
+	    scriptCache.getLoaded(m_pythonScript) == hash)
+	{
+		m_scriptHash = hash;
+		return PyImport_ImportModule(m_pythonScript.c_str());
+	}
+
+	PyObject* code = scriptCache.getCode(hash, source, fileName);
+	if (!code)
+	{
+		return NULL;
+	}
+
+	// Execute code in a new module or in the loaded one
+	PyObject* module = PyImport_ExecCodeModuleEx((char *)m_pythonScript.c_str(),
+						     code,
+						     (char *)fileName.c_str());
+	Py_CLEAR(code);
+
+	if (module)
+	{
+		m_scriptHash = hash;
+	}
+	scriptCache.setLoaded(m_pythonScript, module ? hash : 0);
+
+	return module;
+}
+
+/**
+ * Set the Python script name to load.
+ *
  * If the attribute "file" of "script" items exists
  * in input configuration the m_pythonScript member is updated.
  *
@@ -668,8 +1825,788 @@ bool Python35Filter::setScriptName()
 					  "Check 'script' item in '%s' configuration. "
 					  "Filter has been disabled.",
 					  this->getName().c_str(),
-					  this->getConfig().getName().c_str());
+					  this->getCategoryName().c_str());
 	}
 
 	return !m_pythonScript.empty();
 }
+
+/**
+ * Check a path is relative to FogLAMP data directory:
+ * absolute paths and '..' components are refused
+ *
+ * @param path	The path to check
+ * @return	True if the path is within data directory
+ */
+static bool isDataDirPath(const string& path)
+{
+	if (!path.empty() && path[0] == '/')
+	{
+		return false;
+	}
+
+	size_t start = 0;
+	while (start <= path.length())
+	{
+		size_t end = path.find('/', start);
+		if (end == string::npos)
+		{
+			end = path.length();
+		}
+		if (path.compare(start, end - start, "..") == 0)
+		{
+			return false;
+		}
+		start = end + 1;
+	}
+	return true;
+}
+
+/**
+ * Set the native processing options from a configuration category
+ *
+ * This method must be called with the configuration lock held
+ *
+ * @param config	The filter configuration category
+ */
+void Python35Filter::setOptions(ConfigCategory& config)
+{
+	double deadband = 0.0;
+	double deadbandPercent = 0.0;
+	unsigned long minInterval = 0;
+
+	if (config.itemExists("deadband"))
+	{
+		deadband = strtod(config.getValue("deadband").c_str(), NULL);
+	}
+	if (config.itemExists("deadbandPercent"))
+	{
+		deadbandPercent = strtod(config.getValue("deadbandPercent").c_str(), NULL);
+	}
+	if (config.itemExists("minInterval"))
+	{
+		minInterval = strtoul(config.getValue("minInterval").c_str(), NULL, 10);
+	}
+
+	// Changing deadband values resets last forwarded values
+	m_changeDetector.setDeadband(deadband, deadbandPercent, minInterval);
+
+	if (config.itemExists("readingFormat"))
+	{
+		m_readingRecord = config.getValue("readingFormat").compare("record") == 0;
+	}
+	m_groupByAsset = config.itemExists("groupByAsset") &&
+			 (config.getValue("groupByAsset").compare("true") == 0 ||
+			  config.getValue("groupByAsset").compare("True") == 0);
+
+	if (config.itemExists("gilHoldTime"))
+	{
+		m_gilHoldTime = strtoul(config.getValue("gilHoldTime").c_str(), NULL, 10);
+	}
+
+	if (config.itemExists("timerInterval"))
+	{
+		m_timerInterval = strtoul(config.getValue("timerInterval").c_str(), NULL, 10);
+	}
+
+	// Garbage collection policy
+	string gcPolicy;
+	unsigned long gcBatches = 0, gcInterval = 0, gcIdleTime = 0;
+	if (config.itemExists("gcPolicy"))
+	{
+		gcPolicy = config.getValue("gcPolicy");
+	}
+	if (config.itemExists("gcBatches"))
+	{
+		gcBatches = strtoul(config.getValue("gcBatches").c_str(), NULL, 10);
+	}
+	if (config.itemExists("gcInterval"))
+	{
+		gcInterval = strtoul(config.getValue("gcInterval").c_str(), NULL, 10);
+	}
+	if (config.itemExists("gcIdleTime"))
+	{
+		gcIdleTime = strtoul(config.getValue("gcIdleTime").c_str(), NULL, 10);
+	}
+	m_gcPolicy.setPolicy(gcPolicy, gcBatches, gcInterval, gcIdleTime);
+
+	bool memoryAccounting = false, memoryObjects = false;
+	if (config.itemExists("memoryAccounting"))
+	{
+		memoryAccounting = config.getValue("memoryAccounting").compare("true") == 0 ||
+				   config.getValue("memoryAccounting").compare("True") == 0;
+	}
+	if (config.itemExists("memoryObjects"))
+	{
+		memoryObjects = config.getValue("memoryObjects").compare("true") == 0 ||
+				config.getValue("memoryObjects").compare("True") == 0;
+	}
+	m_memoryAccounting.setEnabled(memoryAccounting, memoryObjects);
+
+	// Priority assets and script method
+	string priorityAssets;
+	if (config.itemExists("priorityAssets"))
+	{
+		priorityAssets = config.getValue("priorityAssets");
+	}
+	m_prioritySelector.setPatterns(priorityAssets);
+	m_priorityScript = config.itemExists("priorityScript") &&
+			   (config.getValue("priorityScript").compare("true") == 0 ||
+			    config.getValue("priorityScript").compare("True") == 0);
+
+	// Post-burst memory reclamation
+	unsigned long reclaimBatchSize = 0, reclaimIdleTime = 0;
+	if (config.itemExists("reclaimBatchSize"))
+	{
+		reclaimBatchSize = strtoul(config.getValue("reclaimBatchSize").c_str(), NULL, 10);
+	}
+	if (config.itemExists("reclaimIdleTime"))
+	{
+		reclaimIdleTime = strtoul(config.getValue("reclaimIdleTime").c_str(), NULL, 10);
+	}
+	m_reclaimer.setPolicy(reclaimBatchSize, reclaimIdleTime);
+
+	// Stats endpoint socket, relative to FogLAMP data dir:
+	// the endpoint is (re)started by startTimers()
+	m_statsSocket.clear();
+	if (config.itemExists("statsSocket"))
+	{
+		string statsSocket = config.getValue("statsSocket");
+		if (!isDataDirPath(statsSocket))
+		{
+			Logger::getLogger()->error("Filter '%s': statsSocket '%s' must be "
+						   "relative to FogLAMP data directory, "
+						   "stats endpoint disabled",
+						   this->getName().c_str(),
+						   statsSocket.c_str());
+		}
+		else if (!statsSocket.empty())
+		{
+			m_statsSocket = getDataDir() + "/" + statsSocket;
+		}
+	}
+
+	// Pure per datapoint mode and its results cache size
+	unsigned long valueCache = 0;
+	if (config.itemExists("valueCache"))
+	{
+		valueCache = strtoul(config.getValue("valueCache").c_str(), NULL, 10);
+	}
+	m_valueCache.setCapacity(valueCache);
+
+	// Memory budget of Python conversions
+	unsigned long memoryBudget = 0;
+	string memoryBudgetPolicy;
+	if (config.itemExists("memoryBudget"))
+	{
+		memoryBudget = strtoul(config.getValue("memoryBudget").c_str(), NULL, 10);
+	}
+	if (config.itemExists("memoryBudgetPolicy"))
+	{
+		memoryBudgetPolicy = config.getValue("memoryBudgetPolicy");
+	}
+	m_conversionBudget.setBudget(memoryBudget * 1024 * 1024, memoryBudgetPolicy);
+
+	// Overload control against batch latency objective
+	unsigned long overloadLatency = 0, overloadSampleRate = 0;
+	string overloadPolicy;
+	if (config.itemExists("overloadLatency"))
+	{
+		overloadLatency = strtoul(config.getValue("overloadLatency").c_str(), NULL, 10);
+	}
+	if (config.itemExists("overloadPolicy"))
+	{
+		overloadPolicy = config.getValue("overloadPolicy");
+	}
+	if (config.itemExists("overloadSampleRate"))
+	{
+		overloadSampleRate = strtoul(config.getValue("overloadSampleRate").c_str(), NULL, 10);
+	}
+	if (overloadLatency &&
+	    overloadPolicy.compare("drop") == 0 &&
+	    !m_prioritySelector.isActive())
+	{
+		// Nothing would reach the script nor pass onwards under overload
+		Logger::getLogger()->warn("Filter '%s': overload policy 'drop' needs "
+					  "priorityAssets, using 'sample'",
+					  this->getName().c_str());
+		overloadPolicy = "sample";
+	}
+	bool overloaded = m_overloadControl.isOverloaded();
+	m_overloadControl.setPolicy(overloadLatency, overloadPolicy, overloadSampleRate);
+	if (overloaded && !m_overloadControl.isOverloaded())
+	{
+		m_stats.addOverloadTransition(false);
+		Logger::getLogger()->info("Filter '%s', overload control disabled",
+					  this->getName().c_str());
+	}
+
+	// Sampling profiler, written in FogLAMP data dir
+	bool profile = false;
+	unsigned long profileInterval = 0;
+	if (config.itemExists("profile"))
+	{
+		profile = config.getValue("profile").compare("true") == 0 ||
+			  config.getValue("profile").compare("True") == 0;
+	}
+	if (config.itemExists("profileInterval"))
+	{
+		profileInterval = strtoul(config.getValue("profileInterval").c_str(), NULL, 10);
+	}
+	m_profiler.setProfile(profile,
+			      profileInterval,
+			      getDataDir() + "/" + this->getCategoryName() + "_profile.folded");
+
+	// Capture file, relative to FogLAMP data dir
+	string captureFile;
+	unsigned long captureMaxSize = 0;
+	unsigned int captureFiles = 0;
+	if (config.itemExists("captureFile"))
+	{
+		captureFile = config.getValue("captureFile");
+		if (!isDataDirPath(captureFile))
+		{
+			Logger::getLogger()->error("Filter '%s': captureFile '%s' must be "
+						   "relative to FogLAMP data directory, "
+						   "capture disabled",
+						   this->getName().c_str(),
+						   captureFile.c_str());
+			captureFile.clear();
+		}
+		else if (!captureFile.empty())
+		{
+			captureFile = getDataDir() + "/" + captureFile;
+		}
+	}
+	if (config.itemExists("captureMaxSize"))
+	{
+		// Size in MBytes
+		captureMaxSize = strtoul(config.getValue("captureMaxSize").c_str(), NULL, 10) *
+				 1024 * 1024;
+	}
+	if (config.itemExists("captureFiles"))
+	{
+		captureFiles = strtoul(config.getValue("captureFiles").c_str(), NULL, 10);
+	}
+	m_capture.setFile(captureFile, captureMaxSize, captureFiles);
+}
+
+/**
+ * Select the priority readings, forwarded before the others
+ *
+ * @param readings	The input readings
+ * @param priority	The output vector with priority readings
+ * @param bulk		The output vector with other readings
+ * @return		True if any priority reading has been found
+ */
+bool Python35Filter::selectPriority(const vector<Reading *>& readings,
+				    vector<Reading *>& priority,
+				    vector<Reading *>& bulk)
+{
+	lock_guard<mutex> guard(m_configMutex);
+
+	if (!m_prioritySelector.isActive())
+	{
+		return false;
+	}
+
+	return m_prioritySelector.select(readings, priority, bulk);
+}
+
+/**
+ * Filter priority readings with the script priority method, if set
+ *
+ * Priority readings are passed onwards unfiltered
+ * if the method is not set or in case of errors.
+ *
+ * @param priority	The priority readings
+ * @param arrival	The batch arrival time, wall clock seconds
+ * @return		New allocated ReadingSet to pass onwards
+ */
+ReadingSet* Python35Filter::filterPriority(const vector<Reading *>& priority,
+					   double arrival)
+{
+	bool callMethod;
+	bool overloaded;
+	uint64_t latency;
+	{
+		lock_guard<mutex> guard(m_configMutex);
+		callMethod = m_priorityScript;
+		overloaded = m_overloadControl.isOverloaded();
+		latency = m_overloadControl.getLatency();
+	}
+
+	vector<Reading *>* newReadings = NULL;
+	if (callMethod)
+	{
+		PyGILState_STATE state = PyGILState_Ensure();
+		newReadings = this->callScript(priority,
+					       m_priorityCall,
+					       overloaded,
+					       latency ? arrival + latency / 1000000.0 : 0.0);
+		PyGILState_Release(state);
+	}
+
+	if (!newReadings)
+	{
+		newReadings = new vector<Reading *>();
+		newReadings->reserve(priority.size());
+		for (auto elem = priority.begin(); elem != priority.end(); ++elem)
+		{
+			newReadings->push_back(new Reading(**elem));
+		}
+	}
+
+	ReadingSet* prioritySet = new ReadingSet(newReadings);
+	delete newReadings;
+
+	return prioritySet;
+}
+
+/**
+ * Get filter and script counters in Prometheus text format,
+ * served by the stats endpoint
+ *
+ * @return	The counters text
+ */
+string Python35Filter::renderStats()
+{
+	string text = m_stats.format(this->getName());
+
+	map<string, long long> counters;
+	map<string, double> gauges;
+	m_metrics.getCounters(counters);
+	m_metrics.getGauges(gauges);
+
+	string label = "{filter=\"" +
+		       FilterStats::escapeLabel(this->getName()) +
+		       "\",name=\"";
+	if (!counters.empty())
+	{
+		text += "# TYPE foglamp_python35_script_counter counter\n";
+	}
+	for (auto it = counters.begin(); it != counters.end(); ++it)
+	{
+		text += "foglamp_python35_script_counter" + label + FilterStats::escapeLabel(it->first) + "\"} " +
+			to_string(it->second) + "\n";
+	}
+	if (!gauges.empty())
+	{
+		text += "# TYPE foglamp_python35_script_gauge gauge\n";
+	}
+	for (auto it = gauges.begin(); it != gauges.end(); ++it)
+	{
+		char value[32];
+		snprintf(value, sizeof(value), "%g", it->second);
+		text += "foglamp_python35_script_gauge" + label + FilterStats::escapeLabel(it->first) + "\"} " +
+			value + "\n";
+	}
+
+	return text;
+}
+
+/**
+ * Check whether readings are over the memory budget
+ * and have to be passed onwards without filtering
+ *
+ * @param readings	The readings to filter
+ * @return		True if readings have to be passed through
+ */
+bool Python35Filter::passThrough(const vector<Reading *>& readings)
+{
+	lock_guard<mutex> guard(m_configMutex);
+	if (!m_conversionBudget.passThrough(readings))
+	{
+		return false;
+	}
+
+	Logger::getLogger()->warn("Filter '%s', %lu readings over memory budget "
+				  "passed through unfiltered",
+				  this->getName().c_str(),
+				  (unsigned long)readings.size());
+	return true;
+}
+
+/**
+ * Check the load and select the readings to filter under overload
+ *
+ * Transitions between normal and overload state are logged
+ * and readings not passed to the script are counted as shed.
+ *
+ * @param readings	The readings to filter
+ * @param sampled	The output vector with sampled readings,
+ *			set with sample action only
+ * @param overloaded	The output overload state, after this batch
+ * @param latency	The output latency objective in microseconds,
+ *			0 if overload control is not active
+ * @return		The action for the batch
+ */
+OverloadControl::Action Python35Filter::shedLoad(const vector<Reading *>& readings,
+						 vector<Reading *>& sampled,
+						 bool& overloaded,
+						 uint64_t& latency)
+{
+	lock_guard<mutex> guard(m_configMutex);
+
+	bool wasOverloaded = m_overloadControl.isOverloaded();
+	OverloadControl::Action action = m_overloadControl.admit(readings.size());
+	overloaded = m_overloadControl.isOverloaded();
+	latency = m_overloadControl.getLatency();
+	if (overloaded != wasOverloaded)
+	{
+		m_stats.addOverloadTransition(overloaded);
+		if (wasOverloaded)
+		{
+			Logger::getLogger()->info("Filter '%s' recovered from overload, %s",
+						  this->getName().c_str(),
+						  m_overloadControl.getLoad().c_str());
+		}
+		else
+		{
+			Logger::getLogger()->warn("Filter '%s' is overloaded, %s",
+						  this->getName().c_str(),
+						  m_overloadControl.getLoad().c_str());
+		}
+	}
+
+	size_t shed = 0;
+	if (action == OverloadControl::ACTION_SAMPLE)
+	{
+		m_overloadControl.sample(readings, sampled);
+		shed = readings.size() - sampled.size();
+	}
+	else if (action != OverloadControl::ACTION_PROCESS)
+	{
+		shed = readings.size();
+	}
+	m_overloadControl.addShed(shed);
+	m_stats.addShed(shed);
+
+	return action;
+}
+
+/**
+ * Record the script processing time of a batch for overload control
+ *
+ * @param readings	Number of filtered readings
+ * @param usec		Processing time in microseconds
+ */
+void Python35Filter::overloadDone(size_t readings, uint64_t usec)
+{
+	lock_guard<mutex> guard(m_configMutex);
+	m_overloadControl.batchDone(readings, usec);
+}
+
+/**
+ * Remove the readings which did not change since
+ * the last forwarded ones, before Python conversion
+ *
+ * @param readings	The input readings
+ * @param changed	The output vector with readings to forward
+ * @return		False if change detection is not active:
+ *			changed vector is not set
+ */
+bool Python35Filter::detectChanges(const vector<Reading *>& readings,
+				   vector<Reading *>& changed)
+{
+	lock_guard<mutex> guard(m_configMutex);
+
+	if (!m_changeDetector.isActive())
+	{
+		return false;
+	}
+
+	unsigned long skipped = m_changeDetector.filter(readings, changed);
+	if (skipped)
+	{
+		Logger::getLogger()->debug("Filter '%s', %lu of %lu readings "
+					   "within deadband have been removed",
+					   this->getName().c_str(),
+					   skipped,
+					   (unsigned long)readings.size());
+	}
+
+	return true;
+}
+
+/**
+ * Save the last forwarded values of readings selected
+ * by detectChanges(), once they have been filtered
+ *
+ * @param readings	The filtered readings
+ */
+void Python35Filter::commitChanges(const vector<Reading *>& readings)
+{
+	lock_guard<mutex> guard(m_configMutex);
+
+	if (m_changeDetector.isActive())
+	{
+		m_changeDetector.commit(readings);
+	}
+}
+
+/**
+ * Pass a set of readings to the output stream
+ *
+ * Calls are serialised as readings may be passed
+ * from ingest and from timer threads.
+ * This must not be called holding the GIL.
+ *
+ * @param readingSet	The readings to pass onwards
+ */
+void Python35Filter::output(ReadingSet* readingSet)
+{
+	lock_guard<mutex> guard(m_outputMutex);
+	m_func(m_data, readingSet);
+}
+
+/**
+ * Pass readings from the script to the output stream,
+ * called by foglamp_filter.emit()
+ *
+ * This method must be called holding the GIL
+ *
+ * @param readings	Python 3.5 Object (list of dicts
+ *			and/or reading records)
+ * @return		True on success, false on errors
+ *			with Python error set
+ */
+bool Python35Filter::emit(PyObject* readings)
+{
+	if (!PyList_Check(readings))
+	{
+		PyErr_SetString(PyExc_TypeError, "emit() argument must be a list");
+		return false;
+	}
+
+	vector<Reading *>* newReadings = this->getFilteredReadings(readings);
+	if (!newReadings)
+	{
+		if (!PyErr_Occurred())
+		{
+			PyErr_SetString(PyExc_ValueError, "emit() invalid readings");
+		}
+		return false;
+	}
+
+	if (newReadings->empty())
+	{
+		// Nothing to pass onwards
+		delete newReadings;
+		return true;
+	}
+
+	ReadingSet* readingSet = new ReadingSet(newReadings);
+	delete newReadings;
+
+	const vector<Reading *>& emitted = readingSet->getAllReadings();
+	for (auto elem = emitted.begin(); elem != emitted.end(); ++elem)
+	{
+		AssetTracker::getAssetTracker()->addAssetTrackingTuple(this->getCategoryName(),
+								       (*elem)->getAssetName(),
+								       string("Filter"));
+	}
+
+	// Release the GIL while next filters process the readings
+	Py_BEGIN_ALLOW_THREADS
+	this->output(readingSet);
+	Py_END_ALLOW_THREADS
+
+	return true;
+}
+
+/**
+ * Start the timer which calls script 'on_timer' method,
+ * if a timer interval is set, the garbage collection
+ * timer, if idle policy is set, the profiler, if enabled,
+ * and the stats endpoint, restarted if its socket changed
+ *
+ * This must not be called holding the GIL
+ */
+void Python35Filter::startTimers()
+{
+	if (m_timerInterval)
+	{
+		m_timer.start(m_timerInterval, [this] { this->onTimer(); });
+	}
+	if (m_gcPolicy.getPolicy() == GcPolicy::GC_IDLE &&
+	    m_gcPolicy.getIdleTime())
+	{
+		m_gcTimer.start(m_gcPolicy.getIdleTime(), [this] { this->onGcTimer(); });
+	}
+	if (m_reclaimer.isActive())
+	{
+		m_reclaimTimer.start(m_reclaimer.getCheckInterval(),
+				     [this] { this->onReclaimTimer(); });
+	}
+	m_profiler.start();
+	m_statsServer.start(m_statsSocket, [this]() { return this->renderStats(); });
+}
+
+/**
+ * Garbage collection timer callback: collect if idle
+ */
+void Python35Filter::onGcTimer()
+{
+	PyGILState_STATE state = PyGILState_Ensure();
+	m_gcPolicy.collectIfIdle();
+	PyGILState_Release(state);
+}
+
+/**
+ * Memory reclamation timer callback: reclaim memory
+ * if requested and no batch is running or arrived
+ * for the idle time
+ */
+void Python35Filter::onReclaimTimer()
+{
+	if (!m_reclaimer.isDue())
+	{
+		return;
+	}
+
+	PyGILState_STATE state = PyGILState_Ensure();
+	// A batch might have started while waiting for the GIL
+	if (!m_reclaimer.isDue())
+	{
+		PyGILState_Release(state);
+		return;
+	}
+
+	// Pooled input dicts are returned too
+	m_readingPool.clear();
+	m_datapointsPool.clear();
+	long reclaimed = m_reclaimer.reclaim();
+	PyGILState_Release(state);
+
+	Logger::getLogger()->info("Filter '%s', memory reclaimed after burst: %ld KBytes",
+				  this->getName().c_str(),
+				  reclaimed / 1024);
+}
+
+/**
+ * Timer callback: call script 'on_timer' method, if any,
+ * and pass returned readings, if any, to the output stream
+ */
+void Python35Filter::onTimer()
+{
+	if (!this->isEnabled())
+	{
+		return;
+	}
+
+	PyGILState_STATE state = PyGILState_Ensure();
+
+	// Bind foglamp_filter module calls to this filter
+	FilterScope scope(this);
+
+	// Fetch timer method in loaded object, once per module version
+	if (!m_pModule ||
+	    !m_timerCall.resolve(m_pModule,
+				 m_moduleVersion,
+				 DEFAULT_FILTER_TIMER_METHOD,
+				 false))
+	{
+		// Timer method is optional
+		PyErr_Clear();
+		PyGILState_Release(state);
+		return;
+	}
+
+	PyObject* pReturn = m_timerCall.call();
+
+	if (!pReturn)
+	{
+		Logger::getLogger()->error("Filter '%s' (%s), script '%s', "
+					   "timer method error",
+					   this->getName().c_str(),
+					   this->getCategoryName().c_str(),
+					   m_pythonScript.c_str());
+		this->logErrorMessage();
+	}
+	else if (pReturn != Py_None && !this->emit(pReturn))
+	{
+		this->logErrorMessage();
+	}
+
+	Py_CLEAR(pReturn);
+
+	PyGILState_Release(state);
+}
+
+/**
+ * Log counters and gauges set by the script
+ * and garbage collection statistics
+ */
+void Python35Filter::logMetrics()
+{
+	map<string, long long> counters;
+	map<string, double> gauges;
+	m_metrics.getCounters(counters);
+	m_metrics.getGauges(gauges);
+
+	for (auto it = counters.begin(); it != counters.end(); ++it)
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', counter '%s' = %lld",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  it->first.c_str(),
+					  it->second);
+	}
+	for (auto it = gauges.begin(); it != gauges.end(); ++it)
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', gauge '%s' = %g",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  it->first.c_str(),
+					  it->second);
+	}
+
+	if (m_outputSchema.isActive())
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', output schema: %s",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  m_outputSchema.getStats().c_str());
+	}
+
+	if (m_valueCache.isActive())
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', value cache: %s",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  m_valueCache.getStats().c_str());
+	}
+
+	if (m_conversionBudget.isActive())
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', memory budget: %s",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  m_conversionBudget.getStats().c_str());
+	}
+
+	if (m_overloadControl.isActive())
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', overload control: %s",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  m_overloadControl.getStats().c_str());
+	}
+
+	if (m_reclaimer.isActive())
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', memory reclamation: %s",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  m_reclaimer.getStats().c_str());
+	}
+
+	if (m_gcPolicy.getPolicy() != GcPolicy::GC_DEFAULT)
+	{
+		Logger::getLogger()->info("Filter '%s', script '%s', garbage collection: %s",
+					  this->getName().c_str(),
+					  m_pythonScript.c_str(),
+					  m_gcPolicy.getStats().c_str());
+	}
+}
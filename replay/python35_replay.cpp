@@ -0,0 +1,350 @@
+/*
+ * FogLAMP "Python 3.5" filter, capture replay driver.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include <plugin_api.h>
+#include <config_category.h>
+#include <filter_plugin.h>
+
+#include "capture.h"
+
+/**
+ * Feed a capture file made by the python35 filter 'captureFile' option
+ * back through the filter and report throughput and latency.
+ *
+ * Usage:
+ *   python35_replay [-m] [-n loops [-g max_growth]] capture_file script_file [filter_config]
+ *   python35_replay -s batch_size [-n loops [-g max_growth]] script_file [filter_config]
+ *
+ *   -m			replay at maximum speed instead of recorded speed
+ *   -s batch_size	replay synthetic batches of batch_size readings
+ *			at maximum speed instead of a capture file,
+ *			SYNTHETIC_LOOP_BATCHES batches per loop
+ *   -n loops		soak test: replay the capture loops times
+ *   -g max_growth	soak test: fail if resident memory grows more than
+ *			max_growth KBytes after the first loop, default 1024
+ *   capture_file	file written by the capture
+ *   script_file	Python 3.5 filter script, its directory is
+ *			added to PYTHONPATH
+ *   filter_config	JSON value of filter 'config' item, default {}
+ */
+
+// Synthetic batches in a loop
+#define SYNTHETIC_LOOP_BATCHES 1000
+// Assets of synthetic readings
+#define SYNTHETIC_ASSETS 4
+// Batch latencies kept for quantiles: a random sample
+// of them is kept in soak tests, not to grow memory
+#define LATENCY_SAMPLES 10000
+
+using namespace std;
+
+extern "C" {
+PLUGIN_HANDLE plugin_init(ConfigCategory* config,
+			  OUTPUT_HANDLE *outHandle,
+			  OUTPUT_STREAM output);
+void plugin_ingest(PLUGIN_HANDLE *handle,
+		   READINGSET *readingSet);
+void plugin_shutdown(PLUGIN_HANDLE *handle);
+};
+
+// Readings passed onwards by the filter
+static unsigned long readingsOut = 0;
+
+/**
+ * Filter output stream: count and remove the readings
+ */
+static void output(OUTPUT_HANDLE *outHandle, READINGSET *readingSet)
+{
+	readingsOut += ((ReadingSet *)readingSet)->getCount();
+	delete (ReadingSet *)readingSet;
+}
+
+/**
+ * Get process resident memory in KBytes
+ */
+static long residentMemory()
+{
+	long size, resident = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm)
+	{
+		if (fscanf(statm, "%ld %ld", &size, &resident) != 2)
+		{
+			resident = 0;
+		}
+		fclose(statm);
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * Create a synthetic batch: readings of SYNTHETIC_ASSETS assets
+ * with integer, float and string datapoints changing every batch
+ *
+ * @param size		Number of readings
+ * @param batch		Batch sequence number
+ * @return		New allocated ReadingSet
+ */
+static ReadingSet* syntheticBatch(unsigned long size, unsigned long batch)
+{
+	vector<Reading *>* readings = new vector<Reading *>();
+	readings->reserve(size);
+	for (unsigned long i = 0; i < size; i++)
+	{
+		unsigned long seq = batch * size + i;
+
+		vector<Datapoint *> values;
+		DatapointValue count((long)seq);
+		values.push_back(new Datapoint("count", count));
+		DatapointValue level((double)(seq % 1000) / 10.0);
+		values.push_back(new Datapoint("level", level));
+		DatapointValue state(string(seq % 2 ? "on" : "off"));
+		values.push_back(new Datapoint("state", state));
+
+		readings->push_back(new Reading("synthetic" + to_string(seq % SYNTHETIC_ASSETS),
+						values));
+	}
+
+	ReadingSet* readingSet = new ReadingSet(readings);
+	delete readings;
+
+	return readingSet;
+}
+
+/**
+ * Escape a string to be set as a JSON string value
+ */
+static string escape(const string& value)
+{
+	string escaped;
+	for (auto c = value.begin(); c != value.end(); ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			escaped += '\\';
+		}
+		escaped += *c;
+	}
+	return escaped;
+}
+
+int main(int argc, char **argv)
+{
+	bool maxSpeed = false;
+	unsigned long loops = 1;
+	long maxGrowth = 1024;
+	unsigned long batchSize = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "mn:g:s:")) != -1)
+	{
+		if (opt == 'm')
+		{
+			maxSpeed = true;
+		}
+		else if (opt == 's')
+		{
+			batchSize = strtoul(optarg, NULL, 10);
+			maxSpeed = true;
+		}
+		else if (opt == 'n')
+		{
+			loops = strtoul(optarg, NULL, 10);
+		}
+		else if (opt == 'g')
+		{
+			maxGrowth = strtol(optarg, NULL, 10);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	// Synthetic batches have no capture file argument
+	int fileArgs = batchSize ? 0 : 1;
+	if (argc - optind < fileArgs + 1 || loops == 0)
+	{
+		fprintf(stderr, "Usage: %s [-m] [-n loops [-g max_growth]] "
+				"capture_file script_file [filter_config]\n"
+				"       %s -s batch_size [-n loops [-g max_growth]] "
+				"script_file [filter_config]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	string captureFile = fileArgs ? argv[optind] : "";
+	string scriptFile = argv[optind + fileArgs];
+	string filterConfig = argc - optind > fileArgs + 1 ? argv[optind + fileArgs + 1] : "{}";
+
+	CaptureReader reader;
+	if (!batchSize && !reader.open(captureFile))
+	{
+		fprintf(stderr, "Cannot open capture file '%s'\n", captureFile.c_str());
+		return 1;
+	}
+
+	// Script is imported as module from its directory
+	size_t found = scriptFile.find_last_of("/");
+	if (found != string::npos)
+	{
+		setenv("PYTHONPATH", scriptFile.substr(0, found).c_str(), 1);
+	}
+
+	string categoryJSON = "{ \"enable\" : { \"description\" : \"Enable\", "
+				"\"type\" : \"boolean\", \"default\" : \"true\", \"value\" : \"true\" }, "
+			      "\"script\" : { \"description\" : \"Script\", "
+				"\"type\" : \"script\", \"default\" : \"\", \"value\" : \"\", "
+				"\"file\" : \"" + escape(scriptFile) + "\" }, "
+			      "\"config\" : { \"description\" : \"Configuration\", "
+				"\"type\" : \"JSON\", \"default\" : \"{}\", "
+				"\"value\" : \"" + escape(filterConfig) + "\" } }";
+	ConfigCategory config("python35_replay", categoryJSON);
+
+	PLUGIN_HANDLE handle = plugin_init(&config, NULL, output);
+	if (!handle)
+	{
+		fprintf(stderr, "Cannot initialise filter with script '%s'\n", scriptFile.c_str());
+		return 1;
+	}
+
+	vector<double> latencies;
+	latencies.reserve(LATENCY_SAMPLES);
+	unsigned long totalBatches = 0;
+	double busy = 0.0, minLatency = 0.0, maxLatency = 0.0;
+	unsigned long readingsIn = 0;
+	uint64_t arrivalTime = 0, firstArrival = 0;
+	ReadingSet* readingSet;
+
+	long firstResident = 0;
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned long loop = 0; loop < loops; loop++)
+	{
+		auto loopStart = chrono::steady_clock::now();
+		firstArrival = 0;
+		unsigned long batches = 0;
+
+		while ((readingSet = batchSize ?
+				     (batches < SYNTHETIC_LOOP_BATCHES ?
+				      syntheticBatch(batchSize, loop * SYNTHETIC_LOOP_BATCHES + batches) :
+				      NULL) :
+				     reader.next(arrivalTime)) != NULL)
+		{
+			batches++;
+			if (!firstArrival)
+			{
+				firstArrival = arrivalTime;
+			}
+			else if (!maxSpeed)
+			{
+				// Wait for recorded arrival time:
+				// times before the first one are not waited
+				uint64_t offset = arrivalTime > firstArrival ?
+						  arrivalTime - firstArrival :
+						  0;
+				this_thread::sleep_until(loopStart + chrono::microseconds(offset));
+			}
+
+			readingsIn += readingSet->getCount();
+
+			auto tStart = chrono::steady_clock::now();
+			plugin_ingest((PLUGIN_HANDLE *)handle, readingSet);
+			double latency = chrono::duration<double, milli>(chrono::steady_clock::now() -
+									 tStart).count();
+
+			busy += latency;
+			if (!totalBatches++ || latency < minLatency)
+			{
+				minLatency = latency;
+			}
+			if (latency > maxLatency)
+			{
+				maxLatency = latency;
+			}
+			if (latencies.size() < LATENCY_SAMPLES)
+			{
+				latencies.push_back(latency);
+			}
+			else
+			{
+				// Reservoir sampling
+				unsigned long i = random() % totalBatches;
+				if (i < LATENCY_SAMPLES)
+				{
+					latencies[i] = latency;
+				}
+			}
+		}
+
+		if (loop == 0)
+		{
+			// Memory after warm up
+			firstResident = residentMemory();
+		}
+		if (!batchSize && !reader.rewind())
+		{
+			break;
+		}
+	}
+
+	long lastResident = residentMemory();
+
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	plugin_shutdown((PLUGIN_HANDLE *)handle);
+
+	if (latencies.empty())
+	{
+		fprintf(stderr, "No batches in capture file '%s'\n", captureFile.c_str());
+		return 1;
+	}
+
+	sort(latencies.begin(), latencies.end());
+
+	printf("Batches:      %lu\n", totalBatches);
+	printf("Readings in:  %lu\n", readingsIn);
+	printf("Readings out: %lu\n", readingsOut);
+	printf("Elapsed:      %.3f s\n", elapsed);
+	printf("Throughput:   %.0f readings/s (%.0f readings/s busy)\n",
+	       readingsIn / elapsed,
+	       busy > 0.0 ? readingsIn / (busy / 1000.0) : 0.0);
+	printf("Latency ms:   min %.3f avg %.3f p50 %.3f p99 %.3f max %.3f\n",
+	       minLatency,
+	       busy / totalBatches,
+	       latencies[latencies.size() / 2],
+	       latencies[(latencies.size() * 99) / 100],
+	       maxLatency);
+
+	if (loops > 1)
+	{
+		printf("Resident KB:  after first loop %ld, at end %ld\n",
+		       firstResident,
+		       lastResident);
+		if (lastResident - firstResident > maxGrowth)
+		{
+			fprintf(stderr, "Soak test failed: memory grew by %ld KBytes\n",
+				lastResident - firstResident);
+			return 2;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+"""
+FogLAMP filtering for readings data
+using Python 3.5
+
+Soak test filter, run by the 'soak' build target on synthetic batches:
+it converts readings both ways, changing, adding and removing data
+"""
+
+__author__ = "Massimiliano Pinto"
+__copyright__ = "Copyright (c) 2019 Dianomic Systems"
+__license__ = "Apache 2.0"
+__version__ = "${VERSION}"
+
+import json
+
+# Native module of the filter plugin
+import foglamp_filter
+
+"""
+filter_config, global variable
+"""
+filter_config = dict()
+
+"""
+Set the Filter configuration into filter_config (global variable)
+
+Arguments:
+configuration -- The JSON configuration
+
+Returns:
+True
+"""
+def set_filter_config(configuration):
+    global filter_config
+    filter_config = json.loads(configuration['config'])
+
+    return True
+
+"""
+Method for filtering readings data
+
+Integer and float values are scaled, a datapoint is added
+and 1 reading every 10 is removed. Datapoint names are bytes.
+
+Arguments:
+readings -- An array of dicts
+
+Returns:
+An array of dicts with modified or dropped readings data
+"""
+def soak35(readings):
+    scale = filter_config.get('scale', 2)
+
+    out = []
+    for elem in readings:
+        reading = elem['reading']
+        if reading[b'count'] % 10 == 0:
+            continue
+
+        reading[b'count'] = reading[b'count'] * scale
+        reading[b'level'] = reading[b'level'] * scale
+        reading[b'scaled'] = scale
+        out.append(elem)
+
+    foglamp_filter.counter("readings", len(out))
+    return out
@@ -0,0 +1,141 @@
+/*
+ * FogLAMP "Python 3.5" filter, compiled script cache.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include "script_cache.h"
+
+using namespace std;
+
+/**
+ * Constructor: empty cache
+ */
+ScriptCache::ScriptCache()
+{
+}
+
+/**
+ * Read a script file and compute the hash of its content
+ *
+ * @param fileName	The script file name
+ * @param source	Set to script content
+ * @param hash		Set to FNV-1a hash of script content
+ * @return		True on success, false if file cannot be read
+ */
+bool ScriptCache::readScript(const string& fileName,
+			     string& source,
+			     uint64_t& hash)
+{
+	ifstream file(fileName.c_str(), ios::in | ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	ostringstream content;
+	content << file.rdbuf();
+	if (file.bad())
+	{
+		return false;
+	}
+	source = content.str();
+
+	hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < source.length(); i++)
+	{
+		hash ^= (unsigned char)source[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return true;
+}
+
+/**
+ * Get the compiled code of a script, compiling it if not cached
+ *
+ * @param hash		Hash of script content
+ * @param source	Script content
+ * @param fileName	Script file name, for error messages
+ * @return		New reference to code object or NULL
+ *			with Python error set
+ */
+PyObject* ScriptCache::getCode(uint64_t hash,
+			       const string& source,
+			       const string& fileName)
+{
+	auto it = m_code.find(hash);
+	if (it != m_code.end())
+	{
+		Py_INCREF(it->second);
+		return it->second;
+	}
+
+	PyObject* code = Py_CompileStringExFlags(source.c_str(),
+						 fileName.c_str(),
+						 Py_file_input,
+						 NULL,
+						 -1);
+	if (!code)
+	{
+		return NULL;
+	}
+
+	if (m_order.size() >= SCRIPT_CACHE_SIZE)
+	{
+		// Remove oldest compiled script
+		Py_CLEAR(m_code[m_order.front()]);
+		m_code.erase(m_order.front());
+		m_order.pop_front();
+	}
+
+	Py_INCREF(code);
+	m_code[hash] = code;
+	m_order.push_back(hash);
+
+	return code;
+}
+
+/**
+ * Get the hash of the code last executed in a module
+ *
+ * @param moduleName	The module name
+ * @return		The hash, 0 if unknown
+ */
+uint64_t ScriptCache::getLoaded(const string& moduleName) const
+{
+	auto it = m_loaded.find(moduleName);
+	return it != m_loaded.end() ? it->second : 0;
+}
+
+/**
+ * Record the hash of the code executed in a module
+ *
+ * @param moduleName	The module name
+ * @param hash		The hash, 0 if unknown
+ */
+void ScriptCache::setLoaded(const string& moduleName, uint64_t hash)
+{
+	m_loaded[moduleName] = hash;
+}
+
+/**
+ * Remove all compiled scripts and executed hashes
+ */
+void ScriptCache::clear()
+{
+	for (auto it = m_code.begin(); it != m_code.end(); ++it)
+	{
+		Py_CLEAR(it->second);
+	}
+	m_code.clear();
+	m_order.clear();
+	m_loaded.clear();
+}
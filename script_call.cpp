@@ -0,0 +1,195 @@
+/*
+ * FogLAMP "Python 3.5" filter, cached calls of script methods.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include "script_call.h"
+
+/**
+ * Constructor: no method is set
+ */
+ScriptCall::ScriptCall() : m_func(NULL),
+			   m_version(0),
+			   m_extraArgs(0),
+			   m_args(NULL)
+{
+}
+
+/**
+ * Resolve and check a module method, unless already
+ * resolved from the same module version
+ *
+ * A Python error is set if the method has just been
+ * looked up and it is missing or not callable.
+ *
+ * @param module	The loaded module
+ * @param version	The module version, changed on each load
+ * @param name		The method name
+ * @param extraArgs	Detect optional context and deadline arguments
+ * @return		True if the method is set
+ */
+bool ScriptCall::resolve(PyObject* module,
+			 unsigned long version,
+			 const char* name,
+			 bool extraArgs)
+{
+	if (version && version == m_version)
+	{
+		return m_func != NULL;
+	}
+
+	this->clear();
+	m_version = version;
+
+	PyObject* func = PyObject_GetAttrString(module, name);
+	if (!func || !PyCallable_Check(func))
+	{
+		if (func && !PyErr_Occurred())
+		{
+			PyErr_Format(PyExc_TypeError, "'%s' is not callable", name);
+		}
+		Py_XDECREF(func);
+		return false;
+	}
+
+	m_func = func;
+	m_extraArgs = extraArgs ? countExtraArgs(func) : 0;
+
+	return true;
+}
+
+/**
+ * Count the optional arguments accepted by a method,
+ * from the names of its positional arguments
+ *
+ * @param func		The method
+ * @return		0 (readings only), 1 (context) or 2 (context and deadline)
+ */
+int ScriptCall::countExtraArgs(PyObject* func)
+{
+	if (!PyFunction_Check(func))
+	{
+		return 0;
+	}
+
+	PyCodeObject* code = (PyCodeObject *)PyFunction_GET_CODE(func);
+	PyObject* names = PyObject_GetAttrString((PyObject *)code, "co_varnames");
+	if (!names || !PyTuple_Check(names))
+	{
+		PyErr_Clear();
+		Py_XDECREF(names);
+		return 0;
+	}
+
+	const char* extraNames[] = { SCRIPT_CALL_CONTEXT_ARG, SCRIPT_CALL_DEADLINE_ARG };
+	int extra = 0;
+	while (extra < 2 &&
+	       extra + 1 < code->co_argcount &&
+	       PyUnicode_CompareWithASCIIString(PyTuple_GET_ITEM(names, extra + 1),
+						extraNames[extra]) == 0)
+	{
+		extra++;
+	}
+	Py_DECREF(names);
+
+	return extra;
+}
+
+/**
+ * Call the method
+ *
+ * @param arg		The first argument
+ * @param context	The context argument, passed if accepted,
+ *			NULL for None
+ * @param deadline	The deadline argument, passed if accepted,
+ *			NULL for None
+ * @return		New reference to the result or NULL on errors
+ */
+PyObject* ScriptCall::call(PyObject* arg, PyObject* context, PyObject* deadline)
+{
+	PyObject* values[] = { arg,
+			       context ? context : Py_None,
+			       deadline ? deadline : Py_None };
+	Py_ssize_t nArgs = 1 + m_extraArgs;
+
+	// Take the tuple: a nested call gets a new one
+	PyObject* args = m_args ? m_args : PyTuple_New(nArgs);
+	m_args = NULL;
+	if (!args)
+	{
+		return NULL;
+	}
+	for (Py_ssize_t i = 0; i < nArgs; i++)
+	{
+		Py_INCREF(values[i]);
+		PyTuple_SET_ITEM(args, i, values[i]);
+	}
+
+	// Method might be cleared while script runs
+	PyObject* func = m_func;
+	Py_INCREF(func);
+	PyObject* ret = PyObject_Call(func, args, NULL);
+	Py_DECREF(func);
+
+	if (Py_REFCNT(args) == 1 &&
+	    !m_args &&
+	    func == m_func &&
+	    PyTuple_GET_SIZE(args) == 1 + m_extraArgs)
+	{
+		// Not retained: empty it for next call
+		for (Py_ssize_t i = 0; i < nArgs; i++)
+		{
+			PyObject* item = PyTuple_GET_ITEM(args, i);
+			PyTuple_SET_ITEM(args, i, NULL);
+			Py_DECREF(item);
+		}
+	}
+	else
+	{
+		Py_CLEAR(args);
+	}
+
+	// Releasing items might have run a nested call
+	if (args && !m_args)
+	{
+		m_args = args;
+	}
+	else
+	{
+		Py_XDECREF(args);
+	}
+
+	return ret;
+}
+
+/**
+ * Call the method without arguments
+ *
+ * @return		New reference to the result or NULL on errors
+ */
+PyObject* ScriptCall::call()
+{
+	// Method might be cleared while script runs
+	PyObject* func = m_func;
+	Py_INCREF(func);
+	PyObject* ret = PyObject_CallObject(func, NULL);
+	Py_DECREF(func);
+
+	return ret;
+}
+
+/**
+ * Release the method and the argument tuple
+ */
+void ScriptCall::clear()
+{
+	Py_CLEAR(m_func);
+	Py_CLEAR(m_args);
+	m_version = 0;
+	m_extraArgs = 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * FogLAMP "Python 3.5" filter, sampling profiler.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+
+#include <Python.h>
+#include <frameobject.h>
+
+#include <logger.h>
+
+#include "script_profiler.h"
+
+// Interval in seconds between writes of the profile file
+#define PROFILE_WRITE_INTERVAL 10
+
+using namespace std;
+
+/**
+ * Constructor: profiler is not enabled
+ */
+ScriptProfiler::ScriptProfiler() : m_enabled(false),
+				   m_interval(0),
+				   m_thread(NULL)
+{
+}
+
+/**
+ * Set profiler options
+ *
+ * This must be called with the profiler stopped
+ *
+ * @param enabled	Whether sampling is enabled
+ * @param interval	Sampling interval in milliseconds
+ * @param fileName	The collapsed stacks file
+ */
+void ScriptProfiler::setProfile(bool enabled,
+				unsigned long interval,
+				const string& fileName)
+{
+	m_enabled = enabled && interval;
+	m_interval = interval;
+	if (fileName.compare(m_fileName) != 0)
+	{
+		m_stacks.clear();
+		m_fileName = fileName;
+	}
+}
+
+/**
+ * Start sampling, if enabled
+ *
+ * This must not be called holding the GIL
+ */
+void ScriptProfiler::start()
+{
+	if (m_enabled)
+	{
+		m_lastWrite = chrono::steady_clock::now();
+		m_timer.start(m_interval, [this] { this->sample(); });
+		Logger::getLogger()->info("Profiling Python script calls every %lu ms to '%s'",
+					  m_interval,
+					  m_fileName.c_str());
+	}
+}
+
+/**
+ * Stop sampling and write collected samples
+ *
+ * This must not be called holding the GIL
+ */
+void ScriptProfiler::stop()
+{
+	m_timer.stop();
+	if (!m_stacks.empty())
+	{
+		this->write();
+	}
+}
+
+/**
+ * Timer callback: sample the frame stack of the thread
+ * calling the script, if a call is in progress
+ */
+void ScriptProfiler::sample()
+{
+	if (m_thread)
+	{
+		string stack;
+
+		PyGILState_STATE state = PyGILState_Ensure();
+
+		// The thread state is valid while the call is in progress
+		PyThreadState* tstate = m_thread;
+		if (tstate)
+		{
+#if PY_VERSION_HEX >= 0x03090000
+			PyFrameObject* frame = PyThreadState_GetFrame(tstate);
+#else
+			PyFrameObject* frame = tstate->frame;
+#endif
+			while (frame)
+			{
+#if PY_VERSION_HEX >= 0x03090000
+				PyCodeObject* code = PyFrame_GetCode(frame);
+#else
+				PyCodeObject* code = frame->f_code;
+#endif
+				const char* name = PyUnicode_AsUTF8(code->co_name);
+				const char* file = PyUnicode_AsUTF8(code->co_filename);
+				const char* base = file ? strrchr(file, '/') : NULL;
+
+				// Collapsed stacks start from the outer frame
+				stack.insert(0,
+					     string(name ? name : "?") + " (" +
+					     (base ? base + 1 : (file ? file : "?")) + ")" +
+					     (stack.empty() ? "" : ";"));
+#if PY_VERSION_HEX >= 0x03090000
+				Py_DECREF(code);
+				PyFrameObject* back = PyFrame_GetBack(frame);
+				Py_DECREF(frame);
+				frame = back;
+#else
+				frame = frame->f_back;
+#endif
+			}
+			PyErr_Clear();
+		}
+
+		PyGILState_Release(state);
+
+		if (!stack.empty())
+		{
+			m_stacks[stack]++;
+		}
+	}
+
+	if (chrono::steady_clock::now() - m_lastWrite >= chrono::seconds(PROFILE_WRITE_INTERVAL))
+	{
+		this->write();
+	}
+}
+
+/**
+ * Write all samples collected so far to the profile file
+ */
+void ScriptProfiler::write()
+{
+	m_lastWrite = chrono::steady_clock::now();
+
+	string tmpName = m_fileName + ".tmp";
+	FILE* file = fopen(tmpName.c_str(), "w");
+	if (!file)
+	{
+		Logger::getLogger()->error("Cannot write profile file '%s': %s",
+					   tmpName.c_str(),
+					   strerror(errno));
+		return;
+	}
+
+	for (auto it = m_stacks.begin(); it != m_stacks.end(); ++it)
+	{
+		fprintf(file, "%s %lu\n", it->first.c_str(), it->second);
+	}
+	fclose(file);
+
+	// Replace the file, readers never see a partial file
+	rename(tmpName.c_str(), m_fileName.c_str());
+}
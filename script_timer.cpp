@@ -0,0 +1,102 @@
+/*
+ * FogLAMP "Python 3.5" filter, periodic timer.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include <chrono>
+
+#include "script_timer.h"
+
+using namespace std;
+
+/**
+ * Constructor: timer is not running
+ */
+ScriptTimer::ScriptTimer() : m_thread(NULL),
+			     m_running(false),
+			     m_interval(0)
+{
+}
+
+/**
+ * Destructor: stop the timer thread
+ */
+ScriptTimer::~ScriptTimer()
+{
+	this->stop();
+}
+
+/**
+ * Start the timer thread, stopping current one if running
+ *
+ * @param interval	Interval in milliseconds
+ * @param callback	Function to call at each interval
+ */
+void ScriptTimer::start(unsigned long interval,
+			function<void()> callback)
+{
+	this->stop();
+
+	m_interval = interval;
+	m_callback = callback;
+	m_running = true;
+	m_thread = new thread(&ScriptTimer::run, this);
+}
+
+/**
+ * Stop the timer thread and wait for its completion
+ *
+ * This must not be called while holding resources
+ * the callback function needs, i.e. the Python GIL
+ */
+void ScriptTimer::stop()
+{
+	if (!m_thread)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_running = false;
+	}
+	m_cv.notify_all();
+
+	m_thread->join();
+	delete m_thread;
+	m_thread = NULL;
+}
+
+/**
+ * Timer thread loop
+ */
+void ScriptTimer::run()
+{
+	auto next = chrono::steady_clock::now();
+
+	unique_lock<mutex> lock(m_mutex);
+	while (m_running)
+	{
+		next += chrono::milliseconds(m_interval);
+		if (m_cv.wait_until(lock, next, [this] { return !m_running; }))
+		{
+			break;
+		}
+
+		lock.unlock();
+		m_callback();
+		lock.lock();
+
+		// Skip missed intervals
+		auto now = chrono::steady_clock::now();
+		if (next < now)
+		{
+			next = now;
+		}
+	}
+}
@@ -0,0 +1,156 @@
+/*
+ * FogLAMP "Python 3.5" filter, cache of per datapoint results.
+ *
+ * Copyright (c) 2019 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+
+#include "value_cache.h"
+
+using namespace std;
+
+/**
+ * Constructor: cache is not active by default
+ */
+ValueCache::ValueCache() : m_capacity(0),
+			   m_hits(0),
+			   m_misses(0)
+{
+}
+
+/**
+ * Set the maximum number of cached results and remove all results
+ *
+ * @param capacity	Maximum number of results, 0 disables the cache
+ */
+void ValueCache::setCapacity(unsigned long capacity)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_capacity = capacity;
+	m_entries.clear();
+	m_index.clear();
+}
+
+/**
+ * Remove all cached results
+ */
+void ValueCache::clear()
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_entries.clear();
+	m_index.clear();
+}
+
+/**
+ * Build the cache key of a datapoint value
+ *
+ * @param asset		The asset name
+ * @param datapoint	The datapoint name
+ * @param value		The input value
+ * @return		The cache key
+ */
+string ValueCache::makeKey(const string& asset,
+			   const string& datapoint,
+			   const DatapointValue& value)
+{
+	string key;
+	key.reserve(asset.length() + datapoint.length() + 2 + 1 + sizeof(double));
+	key.append(asset);
+	key.push_back('\0');
+	key.append(datapoint);
+	key.push_back('\0');
+
+	switch (value.getType())
+	{
+		case DatapointValue::dataTagType::T_INTEGER:
+		{
+			long v = value.toInt();
+			key.push_back('I');
+			key.append((const char *)&v, sizeof(v));
+			break;
+		}
+		case DatapointValue::dataTagType::T_FLOAT:
+		{
+			double v = value.toDouble();
+			key.push_back('F');
+			key.append((const char *)&v, sizeof(v));
+			break;
+		}
+		case DatapointValue::dataTagType::T_STRING:
+			key.push_back('S');
+			key.append(value.toStringValue());
+			break;
+		default:
+			key.push_back('O');
+			key.append(value.toString());
+			break;
+	}
+
+	return key;
+}
+
+/**
+ * Get a cached result and mark it as most recently used
+ *
+ * @param key		The cache key
+ * @param value		Set to a new allocated copy of the result
+ * @return		True if result is cached
+ */
+bool ValueCache::get(const string& key, DatapointValue** value)
+{
+	lock_guard<mutex> guard(m_mutex);
+
+	auto it = m_index.find(key);
+	if (it == m_index.end())
+	{
+		m_misses++;
+		return false;
+	}
+
+	m_entries.splice(m_entries.begin(), m_entries, it->second);
+	*value = new DatapointValue(it->second->m_value);
+	m_hits++;
+
+	return true;
+}
+
+/**
+ * Add a result, removing the least recently used one if cache is full
+ *
+ * @param key		The cache key
+ * @param value		The result
+ */
+void ValueCache::put(const string& key, const DatapointValue& value)
+{
+	lock_guard<mutex> guard(m_mutex);
+
+	if (!m_capacity || m_index.find(key) != m_index.end())
+	{
+		return;
+	}
+
+	if (m_entries.size() >= m_capacity)
+	{
+		m_index.erase(m_entries.back().m_key);
+		m_entries.pop_back();
+	}
+
+	m_entries.emplace_front(key, value);
+	m_index[key] = m_entries.begin();
+}
+
+/**
+ * Get cache counters
+ *
+ * @return	Counters as text
+ */
+string ValueCache::getStats() const
+{
+	lock_guard<mutex> guard(m_mutex);
+	return "hits " + to_string(m_hits) +
+	       ", misses " + to_string(m_misses) +
+	       ", entries " + to_string(m_entries.size());
+}